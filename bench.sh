@@ -0,0 +1,46 @@
+#!/bin/bash
+
+ops="200000"
+seed="1"
+workloads="uniform power-law lifo fifo read-write"
+
+# Pairs of lists_num and bytes_per_list for every trace
+configs="4:65536 8:1048576"
+
+# Check if directory does not exist, then create it
+if [ ! -d bench_traces ]; then
+    mkdir bench_traces
+fi
+
+# Build the benchmark
+make sfl_bench > /dev/null
+
+# Generate every trace once, so the results can be compared between versions
+for workload in $workloads; do
+    for config in $configs; do
+        lists_num=${config%:*}
+        bytes_per_list=${config#*:}
+
+        for reconstruct_type in 0 1 2; do
+            trace="bench_traces/$workload-$lists_num-$bytes_per_list-$reconstruct_type.txt"
+
+            if [ ! -f "$trace" ]; then
+                ./sfl_bench gen $workload $ops $seed $lists_num $bytes_per_list $reconstruct_type $trace
+            fi
+        done
+    done
+done
+
+# Replay every trace in its own process, so the peak RSS is its own
+for trace in bench_traces/*.txt; do
+    ./sfl_bench replay $trace
+done
+
+# Split some of the traces across 1 to as many threads as there are processors
+threads=$(nproc)
+for trace in bench_traces/power-law-8-1048576-1.txt bench_traces/read-write-8-1048576-0.txt; do
+    ./sfl_bench scale $threads $trace
+done
+
+# Compare the placement policies on some of the traces
+./sfl_bench policies bench_traces/uniform-8-1048576-1.txt bench_traces/power-law-8-1048576-0.txt
@@ -0,0 +1,179 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "../header.h"
+
+// The most threads a trace can be split across
+#define BENCH_THREADS 64
+
+// The starting address of the heap of the generated traces
+#define BENCH_START_ADDRESS 0x1000
+
+// The longest text written or read by the generated traces
+#define BENCH_TEXT_SIZE 64
+
+// The workloads the traces can be generated from
+typedef enum {
+	WORKLOAD_UNIFORM, // Uniform sizes, blocks freed in random order
+	WORKLOAD_POWER_LAW, // Log-uniform sizes, blocks freed in random order
+	WORKLOAD_LIFO, // Uniform sizes, the newest block is freed first
+	WORKLOAD_FIFO, // Uniform sizes, the oldest block is freed first
+	WORKLOAD_READ_WRITE, // Uniform sizes, mostly reads and writes
+	WORKLOAD_NUM // The number of workloads
+} workload_t;
+
+// Structure for the blocks allocated while generating a trace
+typedef struct live_t {
+	size_t *addresses; // The addresses of the blocks
+	size_t *sizes; // The sizes of the blocks
+	size_t *written; // The number of bytes written at the start of the blocks
+	size_t first; // The index of the oldest block
+	size_t last; // The index after the newest block
+	size_t capacity; // The number of blocks that fit in the arrays
+} live_t;
+
+// Structure for the latencies of one command
+typedef struct latencies_t {
+	uint64_t *values; // The latency of every execution, in nanoseconds
+	size_t size; // The number of executions
+	size_t capacity; // The number of latencies that fit in the array
+} latencies_t;
+
+// Structure for a command of a trace split across threads, whose block is
+// given by the order of its MALLOC instead of its address
+typedef struct op_t {
+	command_t command; // MALLOC, FREE, READ or WRITE
+	size_t handle; // The index of the MALLOC of the block
+	size_t offset; // The offset of the first byte from the start of the block
+	size_t size; // The size of the block, or the number of bytes
+	char *text; // The text of WRITE, NULL for the other commands
+} op_t;
+
+// Structure for a trace split across threads
+typedef struct trace_t {
+	op_t *ops; // The commands of the trace
+	size_t size; // The number of commands
+	size_t capacity; // The number of commands that fit in the array
+	size_t handles; // The number of blocks
+	size_t max_size; // The largest number of bytes read at once
+	arguments_t init; // The arguments of the INIT_HEAP of the trace
+} trace_t;
+
+// Structure for the part of a trace replayed by one thread
+typedef struct worker_t {
+	trace_t *trace; // The trace
+	sfl_heap_t *heap; // The heap shared by every thread
+	size_t *addresses; // The address of every block, shared by every thread
+	size_t *indexes; // The commands of the blocks of the thread, in order
+	size_t size; // The number of commands of the thread
+	bool cached; // Whether the thread goes through a cache of its own
+	size_t failed; // The number of MALLOCs which found no memory
+} worker_t;
+
+// Functions from src/bench/generate.c
+
+// @brief Function to get the next number of a xorshift generator
+// @param state Pointer to the state of the generator, never 0
+// @return A pseudo-random number
+uint64_t bench_random(uint64_t *state);
+
+// @brief Function to find a workload by its name
+// @param name The name of the workload
+// @return The workload, WORKLOAD_NUM if there is no such workload
+workload_t find_workload(const char *name);
+
+// @brief Function to add a block to the live blocks
+// @param live Pointer to the live blocks
+// @param address The address of the block
+// @param size The size of the block
+void live_push(live_t *live, size_t address, size_t size);
+
+// @brief Function to remove a live block, keeping the order of the others if
+// it is the oldest or the newest
+// @param live Pointer to the live blocks
+// @param index The index of the block
+void live_remove(live_t *live, size_t index);
+
+// @brief Function to generate a trace and write it to a file
+// @param workload The workload of the trace
+// @param ops The number of commands, besides INIT_HEAP and DESTROY_HEAP
+// @param seed The seed of the generator
+// @param lists_num The number of segregated free lists
+// @param bytes_per_list The number of bytes per list
+// @param reconstruct_type The type of reconstruction to be done
+// @param trace The file the trace is written to
+void generate(workload_t workload, size_t ops, uint64_t seed, size_t lists_num,
+			  size_t bytes_per_list, size_t reconstruct_type, FILE *trace);
+
+// Functions from src/bench/replay.c
+
+// @brief Function to compare two latencies, for qsort()
+// @param first Pointer to the first latency
+// @param second Pointer to the second latency
+// @return A negative number, 0 or a positive number, like strcmp()
+int compare_latencies(const void *first, const void *second);
+
+// @brief Function to calculate the memory used for the metadata of a heap
+// @param heap Pointer to the heap
+// @return The number of bytes allocated outside of the heap data
+size_t metadata_size(sfl_heap_t *heap);
+
+// @brief Function to replay a trace and report its performance to stderr
+// @param path The path of the trace, either text or binary
+void replay(const char *path);
+
+// Functions from src/bench/threads.c
+
+// @brief Function to add a command to a trace, doubling it if it is full
+// @param trace Pointer to the trace
+// @param op Pointer to the command
+void trace_push(trace_t *trace, op_t *op);
+
+// @brief Function to read a trace and give every block a handle, by replaying
+// it on a heap of its own
+// @param path The path of the trace, either text or binary
+// @param trace Pointer to the trace to fill
+// @return true if the trace has an INIT_HEAP, false otherwise
+bool trace_load(const char *path, trace_t *trace);
+
+// @brief Function to free the memory of a trace
+// @param trace Pointer to the trace
+void trace_destroy(trace_t *trace);
+
+// @brief Function to replay the commands of the blocks of one thread
+// @param arg Pointer to the worker_t of the thread
+// @return NULL
+void *worker_run(void *arg);
+
+// @brief Function to replay a trace with many threads over one heap
+// @param trace Pointer to the trace
+// @param threads The number of threads
+// @param cached Whether every thread goes through a cache of its own
+// @param failed Pointer to the number of MALLOCs which found no memory
+// @return The time of the replay, in nanoseconds
+uint64_t run_threads(trace_t *trace, size_t threads, bool cached,
+					 size_t *failed);
+
+// @brief Function to report the throughput of a trace from 1 to many threads,
+// with and without the caches of the threads
+// @param path The path of the trace, either text or binary
+// @param max_threads The largest number of threads
+void scale(const char *path, size_t max_threads);
+
+// Functions from src/bench/policies.c
+
+// @brief Function to replay a trace on one thread with a placement policy
+// @param trace Pointer to the trace
+// @param policy The placement policy of the heap
+// @param stats Pointer to the statistics of the heap at the end of the trace
+// @param failed Pointer to the number of MALLOCs which found no memory
+// @return The time of the replay, in nanoseconds
+uint64_t run_policy(trace_t *trace, sfl_policy_t policy, sfl_stats_t *stats,
+					size_t *failed);
+
+// @brief Function to report the throughput and the fragmentation of a trace
+// under every placement policy
+// @param path The path of the trace, either text or binary
+void policies(const char *path);
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,188 @@
+#include "bench.h"
+
+// The names of the workloads, in the order of workload_t
+static const char *workload_names[] = {
+	"uniform", "power-law", "lifo", "fifo", "read-write",
+};
+
+uint64_t bench_random(uint64_t *state)
+{
+	// Shift the state, then scramble it with a multiplication
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+
+	return *state * 0x2545f4914f6cdd1d;
+}
+
+workload_t find_workload(const char *name)
+{
+	// Search the name in the table of workloads
+	for (size_t i = 0; i < WORKLOAD_NUM; i++)
+		if (!strcmp(name, workload_names[i]))
+			return i;
+
+	return WORKLOAD_NUM;
+}
+
+void live_push(live_t *live, size_t address, size_t size)
+{
+	// Move the blocks to the start of the arrays, or double them, when the
+	// last position is used
+	if (live->last == live->capacity) {
+		size_t count = live->last - live->first;
+
+		if (2 * count >= live->capacity) {
+			live->capacity = live->capacity ? 2 * live->capacity : POOL_SIZE;
+
+			live->addresses =
+				realloc(live->addresses, live->capacity * sizeof(size_t));
+			DIE(!live->addresses, "Realloc failed while reallocating live");
+			live->sizes = realloc(live->sizes, live->capacity * sizeof(size_t));
+			DIE(!live->sizes, "Realloc failed while reallocating live");
+			live->written =
+				realloc(live->written, live->capacity * sizeof(size_t));
+			DIE(!live->written, "Realloc failed while reallocating live");
+		}
+
+		memmove(live->addresses, live->addresses + live->first,
+				count * sizeof(size_t));
+		memmove(live->sizes, live->sizes + live->first,
+				count * sizeof(size_t));
+		memmove(live->written, live->written + live->first,
+				count * sizeof(size_t));
+		live->first = 0;
+		live->last = count;
+	}
+
+	// Add the block after the newest one
+	live->addresses[live->last] = address;
+	live->sizes[live->last] = size;
+	live->written[live->last] = 0;
+	live->last += 1;
+}
+
+void live_remove(live_t *live, size_t index)
+{
+	// The oldest block is removed by moving the start of the blocks
+	if (index == live->first) {
+		live->first += 1;
+		return;
+	}
+
+	// Any other block is replaced by the newest one
+	live->last -= 1;
+	live->addresses[index] = live->addresses[live->last];
+	live->sizes[index] = live->sizes[live->last];
+	live->written[index] = live->written[live->last];
+}
+
+void generate(workload_t workload, size_t ops, uint64_t seed, size_t lists_num,
+			  size_t bytes_per_list, size_t reconstruct_type, FILE *trace)
+{
+	// Keep the state of the generator away from 0
+	uint64_t state = seed * 2 + 1;
+
+	// Run the allocator while generating, so the addresses of the trace
+	// are the ones it returns
+	sfl_heap_t *heap = sfl_init(BENCH_START_ADDRESS, lists_num,
+								bytes_per_list, reconstruct_type);
+	size_t max_size = 8 * ((size_t)1 << (lists_num - 1));
+
+	fprintf(trace, "INIT_HEAP 0x%x %lu %lu %lu\n", BENCH_START_ADDRESS,
+			lists_num, bytes_per_list, reconstruct_type);
+
+	// The shares of MALLOC and FREE, in percents, the rest being split
+	// between WRITE and READ
+	size_t malloc_share = workload == WORKLOAD_READ_WRITE ? 15 : 45;
+	size_t free_share = malloc_share;
+
+	// The blocks which can be freed, read and written
+	live_t live = { 0 };
+
+	// The number of blocks to free after the heap ran out of memory
+	size_t draining = 0;
+
+	for (size_t op = 0; op < ops; op++) {
+		size_t share = bench_random(&state) % 100;
+		size_t count = live.last - live.first;
+
+		if (!count || (!draining && share < malloc_share)) {
+			// Choose the size of the block
+			size_t size;
+			if (workload == WORKLOAD_POWER_LAW) {
+				// Every power of two is equally likely, so small blocks are
+				// much more frequent than large ones
+				size_t bits = __builtin_ctzll(max_size) + 1;
+				size = (size_t)1 << bench_random(&state) % bits;
+				size += bench_random(&state) % size;
+				if (size > max_size)
+					size = max_size;
+			} else {
+				size = 1 + bench_random(&state) % max_size;
+			}
+
+			fprintf(trace, "MALLOC %lu\n", size);
+
+			// Remember the block, or free half of the blocks if there is
+			// no memory left
+			size_t address = sfl_malloc(heap, size);
+			if (address)
+				live_push(&live, address, size);
+			else
+				draining = count / 2;
+		} else if (draining || share < malloc_share + free_share) {
+			// Choose the block to free from the pattern of the workload
+			size_t index;
+			if (workload == WORKLOAD_LIFO)
+				index = live.last - 1;
+			else if (workload == WORKLOAD_FIFO)
+				index = live.first;
+			else
+				index = live.first + bench_random(&state) % count;
+
+			size_t address = live.addresses[index];
+			fprintf(trace, "FREE 0x%lx\n", address);
+
+			sfl_free(heap, address);
+			live_remove(&live, index);
+
+			if (draining)
+				draining -= 1;
+		} else {
+			// Read or write the start of a random block
+			size_t index = live.first + bench_random(&state) % count;
+			size_t address = live.addresses[index];
+
+			if (share % 2 && live.written[index]) {
+				// Only read the bytes which were written, so the output does
+				// not depend on what the heap held before
+				size_t size = 1 + bench_random(&state) % live.written[index];
+				fprintf(trace, "READ 0x%lx %lu\n", address, size);
+			} else {
+				size_t size = live.sizes[index] < BENCH_TEXT_SIZE ?
+								  live.sizes[index] :
+								  BENCH_TEXT_SIZE;
+				size = 1 + bench_random(&state) % size;
+
+				// Write a text of random letters
+				char text[BENCH_TEXT_SIZE + 1];
+				for (size_t i = 0; i < size; i++)
+					text[i] = 'a' + bench_random(&state) % 26;
+				text[size] = '\0';
+
+				fprintf(trace, "WRITE 0x%lx \"%s\" %lu\n", address, text, size);
+				if (size > live.written[index])
+					live.written[index] = size;
+			}
+		}
+	}
+
+	fprintf(trace, "DESTROY_HEAP\n");
+
+	// Free the memory of the allocator and of the live blocks
+	sfl_destroy(heap);
+	free(live.addresses);
+	free(live.sizes);
+	free(live.written);
+}
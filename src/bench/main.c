@@ -0,0 +1,63 @@
+#include "bench.h"
+
+int main(int argc, char *argv[])
+{
+	// The output of the commands is not part of the benchmark
+	DIE(!freopen("/dev/null", "w", stdout),
+		"Freopen failed while discarding the output");
+
+	if (argc == 9 && !strcmp(argv[1], "gen")) {
+		// Find the workload of the trace
+		workload_t workload = find_workload(argv[2]);
+		if (workload == WORKLOAD_NUM) {
+			fprintf(stderr, "Unknown workload %s\n", argv[2]);
+			return 1;
+		}
+
+		// Generate the trace in the given file
+		FILE *trace = fopen(argv[8], "w");
+		DIE(!trace, "Fopen failed while opening the trace");
+
+		generate(workload, strtoul(argv[3], NULL, 10),
+				 strtoull(argv[4], NULL, 10), strtoul(argv[5], NULL, 10),
+				 strtoul(argv[6], NULL, 10), strtoul(argv[7], NULL, 10),
+				 trace);
+
+		fclose(trace);
+		return 0;
+	}
+
+	if (argc > 2 && !strcmp(argv[1], "replay")) {
+		// Replay every given trace
+		for (int i = 2; i < argc; i++)
+			replay(argv[i]);
+
+		return 0;
+	}
+
+	if (argc > 3 && !strcmp(argv[1], "scale")) {
+		// Split every given trace across 1 to max_threads threads
+		for (int i = 3; i < argc; i++)
+			scale(argv[i], strtoul(argv[2], NULL, 10));
+
+		return 0;
+	}
+
+	if (argc > 2 && !strcmp(argv[1], "policies")) {
+		// Compare the placement policies on every given trace
+		for (int i = 2; i < argc; i++)
+			policies(argv[i]);
+
+		return 0;
+	}
+
+	fprintf(stderr, "Usage: %s gen <workload> <ops> <seed> <lists_num> "
+					"<bytes_per_list> <reconstruct_type> <trace>\n"
+					"       %s replay <trace>...\n"
+					"       %s scale <max_threads> <trace>...\n"
+					"       %s policies <trace>...\n"
+					"Workloads: uniform, power-law, lifo, fifo, read-write\n",
+			argv[0], argv[0], argv[0], argv[0]);
+
+	return 1;
+}
@@ -0,0 +1,78 @@
+// clock_gettime() is not part of C99
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+
+#include "bench.h"
+
+uint64_t run_policy(trace_t *trace, sfl_policy_t policy, sfl_stats_t *stats,
+					size_t *failed)
+{
+	// Create the heap with the policy and the addresses of the blocks
+	arguments_t *init = &trace->init;
+	sfl_heap_t *heap = sfl_init(init->address, init->lists_num,
+								init->bytes_per_list, init->reconstruct_type);
+	sfl_set_policy(heap, policy);
+	size_t *addresses = calloc(trace->handles + 1, sizeof(size_t));
+	DIE(!addresses, "Calloc failed while allocating addresses");
+
+	// Replay every command on one thread, in the order of the trace
+	worker_t worker = { trace, heap, addresses, NULL, trace->size, false, 0 };
+	worker.indexes = malloc((trace->size + 1) * sizeof(size_t));
+	DIE(!worker.indexes, "Malloc failed while allocating indexes");
+	for (size_t i = 0; i < trace->size; i++)
+		worker.indexes[i] = i;
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	worker_run(&worker);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	// Keep the statistics of the heap at the end of the trace
+	sfl_stats(heap, stats);
+	*failed = worker.failed;
+
+	free(worker.indexes);
+	free(addresses);
+	sfl_destroy(heap);
+
+	return (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 + end.tv_nsec -
+		   start.tv_nsec;
+}
+
+void policies(const char *path)
+{
+	// Read the trace once, its blocks following their handles under every
+	// policy
+	trace_t trace;
+	if (!trace_load(path, &trace)) {
+		fprintf(stderr, "%s: the trace has no INIT_HEAP\n", path);
+		trace_destroy(&trace);
+		return;
+	}
+
+	fprintf(stderr, "%s: %lu commands on %lu blocks\n", path, trace.size,
+			trace.handles);
+	fprintf(stderr, "  %-16s %14s %10s %10s %12s %10s\n", "policy",
+			"commands/s", "failed", "splits", "wasted(B)", "ext.frag");
+
+	for (size_t policy = 0; policy < SFL_POLICIES; policy++) {
+		sfl_stats_t stats;
+		size_t failed;
+		uint64_t time = run_policy(&trace, policy, &stats, &failed);
+
+		// The share of the free memory outside of the largest free block
+		double fragmentation = 0;
+		if (stats.free_memory)
+			fragmentation = 100.0 *
+							(stats.free_memory - stats.largest_free_block) /
+							stats.free_memory;
+
+		fprintf(stderr, "  %-16s %14.0f %10lu %10lu %12lu %9.2f%%\n",
+				policy_name(policy), time ? trace.size * 1e9 / time : 0.0,
+				failed, stats.fragmentations, stats.wasted_memory,
+				fragmentation);
+	}
+
+	trace_destroy(&trace);
+}
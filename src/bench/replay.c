@@ -0,0 +1,160 @@
+// clock_gettime() and getrusage() are not part of C99
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+#include <sys/resource.h>
+
+#include "bench.h"
+
+// The names of the commands, in the order of command_t
+static const char *command_names[] = {
+	"INIT_HEAP", "MALLOC", "FREE", "READ", "WRITE", "DUMP_MEMORY",
+	"DESTROY_HEAP", "STATS", "SNAPSHOT", "RESTORE", "PROFILE",
+	"FRAG_REPORT", "REALLOC", "CALLOC", "MEMALIGN", "UNKNOWN",
+};
+
+int compare_latencies(const void *first, const void *second)
+{
+	uint64_t a = *(const uint64_t *)first;
+	uint64_t b = *(const uint64_t *)second;
+
+	return (a > b) - (a < b);
+}
+
+size_t metadata_size(sfl_heap_t *heap)
+{
+	sfl_t *sfl = &heap->sfl;
+
+	// The context of the heap
+	size_t size = sizeof(sfl_heap_t);
+
+	// The pages of the table of lists which were used and the uncarved parts
+	// of the initial lists
+	size += sfl->list_pages * sizeof(list_t *);
+	for (size_t i = 0; i < sfl->list_pages; i++)
+		if (sfl->lists[i])
+			size += LIST_PAGE_SIZE * sizeof(list_t);
+	size += sfl->regions_num * sizeof(region_t);
+
+	// The words of every level of the bitmaps, the states of the pages
+	// having the same shape
+	for (size_t level = 0; level < sfl->used.levels; level++)
+		size += (sfl->used.counts[level] + 63) / 64 * sizeof(uint64_t);
+	for (size_t level = 0; level < sfl->touched.levels; level++)
+		size += 2 * (sfl->touched.counts[level] + 63) / 64 * sizeof(uint64_t);
+
+	// The records of the small free blocks and their table
+	size += sfl->pool.capacity * sizeof(block_t);
+	size += sfl->pool.table_size * sizeof(size_t);
+
+	// The nodes of the allocated blocks
+	size += heap->allocated_blocks.capacity * sizeof(tree_node_t);
+
+	return size;
+}
+
+void replay(const char *path)
+{
+	// Open the trace
+	FILE *file = fopen(path, "rb");
+	DIE(!file, "Fopen failed while opening the trace");
+
+	// Read the trace in the binary format if it starts like one
+	input_t input;
+	input_init(&input, file);
+	input.binary = binary_magic(&input);
+
+	// The heap is created by the INIT_HEAP of the trace
+	sfl_heap_t *heap = NULL;
+
+	// Keep the latencies of every command, along with the heap size
+	latencies_t latencies[COMMAND_EOF] = { 0 };
+	size_t heap_size = 0, peak_metadata = 0;
+	uint64_t total = 0;
+
+	bool running = true;
+	while (running) {
+		command_t command = input_command(&input);
+
+		// Time the command, along with the parsing of its arguments
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		running = run_command(&heap, &input, command);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		// The end of the trace is not a command
+		if (command == COMMAND_EOF)
+			break;
+
+		uint64_t latency = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 +
+						   end.tv_nsec - start.tv_nsec;
+		total += latency;
+
+		// Save the latency, doubling the array if it is full
+		latencies_t *current = &latencies[command];
+		if (current->size == current->capacity) {
+			current->capacity = current->capacity ? 2 * current->capacity :
+													POOL_SIZE;
+			current->values = realloc(current->values,
+									  current->capacity * sizeof(uint64_t));
+			DIE(!current->values,
+				"Realloc failed while reallocating latencies");
+		}
+		current->values[current->size++] = latency;
+
+		// Measure the heap while it exists
+		if ((command == COMMAND_INIT_HEAP || command == COMMAND_RESTORE) && heap)
+			heap_size = heap->sfl.regions_num * heap->bytes_per_list;
+		if (running && heap) {
+			size_t metadata = metadata_size(heap);
+			if (metadata > peak_metadata)
+				peak_metadata = metadata;
+		}
+	}
+
+	input_destroy(&input);
+	fclose(file);
+
+	// Report the throughput of the whole trace
+	size_t ops = 0;
+	for (size_t i = 0; i < COMMAND_EOF; i++)
+		ops += latencies[i].size;
+
+	fprintf(stderr, "%s: %lu commands in %.3f ms, %.0f commands/s\n", path,
+			ops, total / 1e6, total ? ops * 1e9 / total : 0.0);
+
+	// Report the latency percentiles of every command
+	fprintf(stderr, "  %-12s %10s %10s %10s %10s %10s %10s\n", "command",
+			"count", "mean(ns)", "p50(ns)", "p90(ns)", "p99(ns)", "max(ns)");
+
+	for (size_t i = 0; i < COMMAND_EOF; i++) {
+		latencies_t *current = &latencies[i];
+		if (!current->size)
+			continue;
+
+		qsort(current->values, current->size, sizeof(uint64_t),
+			  compare_latencies);
+
+		uint64_t sum = 0;
+		for (size_t j = 0; j < current->size; j++)
+			sum += current->values[j];
+
+		fprintf(stderr, "  %-12s %10lu %10lu %10lu %10lu %10lu %10lu\n",
+				command_names[i], current->size, sum / current->size,
+				current->values[current->size * 50 / 100],
+				current->values[current->size * 90 / 100],
+				current->values[current->size * 99 / 100],
+				current->values[current->size - 1]);
+
+		free(current->values);
+	}
+
+	// Report the memory of the process and of the metadata
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	fprintf(stderr, "  peak RSS: %ld KiB\n", usage.ru_maxrss);
+	fprintf(stderr, "  heap: %lu bytes, peak metadata: %lu bytes (%.2f%%)\n",
+			heap_size, peak_metadata,
+			heap_size ? 100.0 * peak_metadata / heap_size : 0.0);
+}
@@ -0,0 +1,303 @@
+// clock_gettime() is not part of C99
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+
+#include "bench.h"
+
+void trace_push(trace_t *trace, op_t *op)
+{
+	// Double the commands if they are full
+	if (trace->size == trace->capacity) {
+		trace->capacity = trace->capacity ? 2 * trace->capacity : POOL_SIZE;
+		trace->ops = realloc(trace->ops, trace->capacity * sizeof(op_t));
+		DIE(!trace->ops, "Realloc failed while reallocating trace");
+	}
+
+	trace->ops[trace->size++] = *op;
+}
+
+bool trace_load(const char *path, trace_t *trace)
+{
+	// Open the trace
+	FILE *file = fopen(path, "rb");
+	DIE(!file, "Fopen failed while opening the trace");
+
+	// Read the trace in the binary format if it starts like one
+	input_t input;
+	input_init(&input, file);
+	input.binary = binary_magic(&input);
+
+	memset(trace, 0, sizeof(trace_t));
+
+	// The handle of the block of every node of the allocated blocks
+	size_t *handles = NULL, capacity = 0;
+	sfl_heap_t *heap = NULL;
+
+	bool running = true;
+	while (running) {
+		command_t command = input_command(&input);
+		if (command == COMMAND_EOF)
+			break;
+
+		arguments_t arguments;
+		input_arguments(&input, command, &arguments);
+
+		// Nothing but INIT_HEAP can be done before the heap exists
+		if (!heap && command != COMMAND_INIT_HEAP)
+			continue;
+
+		op_t op = { command, 0, 0, 0, NULL };
+		tree_t *tree = heap ? &heap->allocated_blocks : NULL;
+
+		switch (command) {
+		case COMMAND_INIT_HEAP:
+			// Replay the trace on a heap like the one of the threads
+			heap = sfl_init(arguments.address, arguments.lists_num,
+							arguments.bytes_per_list,
+							arguments.reconstruct_type);
+			trace->init = arguments;
+			break;
+		case COMMAND_MALLOC: {
+			// The blocks which were not allocated are left out
+			size_t address = sfl_malloc(heap, arguments.size);
+			if (!address)
+				break;
+
+			// Give the block the next handle, growing the handles along with
+			// the nodes of the allocated blocks
+			size_t node = tree_find(tree, address - heap->start_address);
+			if (capacity < tree->capacity) {
+				capacity = tree->capacity;
+				handles = realloc(handles, capacity * sizeof(size_t));
+				DIE(!handles, "Realloc failed while reallocating handles");
+			}
+			handles[node] = trace->handles++;
+
+			op.handle = handles[node];
+			op.size = arguments.size;
+			trace_push(trace, &op);
+			break;
+		}
+		case COMMAND_FREE: {
+			// The invalid frees are left out
+			size_t node = tree_find(tree, arguments.address -
+											  heap->start_address);
+			if (node == NO_BLOCK)
+				break;
+
+			op.handle = handles[node];
+			sfl_free(heap, arguments.address);
+			trace_push(trace, &op);
+			break;
+		}
+		case COMMAND_READ:
+		case COMMAND_WRITE: {
+			// Write no more than the text, which ends at its first null byte
+			op.size = arguments.size;
+			if (arguments.text) {
+				const char *end = memchr(arguments.text, '\0',
+										 arguments.text_length);
+				size_t length = end ? (size_t)(end - arguments.text) :
+									  arguments.text_length;
+				if (length < op.size)
+					op.size = length;
+			}
+
+			// Only the bytes inside one block can follow it to another address
+			size_t offset = arguments.address - heap->start_address;
+			size_t node = tree_floor(tree, offset);
+			if (node == NO_BLOCK || offset + op.size >
+										tree->nodes[node].address +
+											tree->nodes[node].size)
+				break;
+
+			op.handle = handles[node];
+			op.offset = offset - tree->nodes[node].address;
+			if (command == COMMAND_READ && op.size > trace->max_size)
+				trace->max_size = op.size;
+
+			// Copy the text out of the buffer of the input, which is reused
+			// by the next commands
+			if (command == COMMAND_WRITE) {
+				op.text = malloc(op.size + 1);
+				DIE(!op.text, "Malloc failed while allocating text");
+				memcpy(op.text, arguments.text, op.size);
+				op.text[op.size] = '\0';
+			}
+
+			trace_push(trace, &op);
+			break;
+		}
+		case COMMAND_DESTROY_HEAP:
+			// The rest of the trace is not replayed
+			running = false;
+			break;
+		default:
+			// The other commands do not change the blocks
+			break;
+		}
+	}
+
+	// Free the heap of the replay, along with the input
+	bool initialized = heap != NULL;
+	if (heap)
+		sfl_destroy(heap);
+	free(handles);
+	input_destroy(&input);
+	fclose(file);
+
+	return initialized;
+}
+
+void trace_destroy(trace_t *trace)
+{
+	// Free the texts of the WRITEs, then the commands
+	for (size_t i = 0; i < trace->size; i++)
+		free(trace->ops[i].text);
+
+	free(trace->ops);
+}
+
+void *worker_run(void *arg)
+{
+	worker_t *worker = arg;
+	op_t *ops = worker->trace->ops;
+	size_t *addresses = worker->addresses;
+
+	// Go through a cache of the thread, if there is one
+	sfl_cache_t *cache = worker->cached ? sfl_cache_create(worker->heap) : NULL;
+
+	// Allocate the memory of the READs
+	char *buffer = malloc(worker->trace->max_size + 1);
+	DIE(!buffer, "Malloc failed while allocating buffer");
+
+	for (size_t i = 0; i < worker->size; i++) {
+		op_t *op = &ops[worker->indexes[i]];
+		size_t *address = &addresses[op->handle];
+
+		// The blocks which found no memory are skipped
+		if (op->command != COMMAND_MALLOC && !*address)
+			continue;
+
+		switch (op->command) {
+		case COMMAND_MALLOC:
+			*address = cache ? sfl_cache_malloc(cache, op->size) :
+							   sfl_malloc(worker->heap, op->size);
+			worker->failed += !*address;
+			break;
+		case COMMAND_FREE:
+			if (cache)
+				sfl_cache_free(cache, *address);
+			else
+				sfl_free(worker->heap, *address);
+			*address = 0;
+			break;
+		case COMMAND_READ:
+			sfl_read(worker->heap, *address + op->offset, buffer, op->size);
+			break;
+		case COMMAND_WRITE:
+			sfl_write(worker->heap, *address + op->offset, op->text, op->size);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// Give the cached blocks back to the heap
+	if (cache)
+		sfl_cache_destroy(cache);
+	free(buffer);
+
+	return NULL;
+}
+
+uint64_t run_threads(trace_t *trace, size_t threads, bool cached,
+					 size_t *failed)
+{
+	// Create the heap shared by the threads and the addresses of the blocks
+	arguments_t *init = &trace->init;
+	sfl_heap_t *heap = sfl_init(init->address, init->lists_num,
+								init->bytes_per_list, init->reconstruct_type);
+	size_t *addresses = calloc(trace->handles + 1, sizeof(size_t));
+	DIE(!addresses, "Calloc failed while allocating addresses");
+
+	// Give every block to a thread, along with all of its commands
+	worker_t workers[BENCH_THREADS];
+	for (size_t i = 0; i < threads; i++) {
+		workers[i] = (worker_t){ trace, heap, addresses, NULL, 0, cached, 0 };
+		workers[i].indexes = malloc((trace->size + 1) * sizeof(size_t));
+		DIE(!workers[i].indexes, "Malloc failed while allocating indexes");
+	}
+
+	for (size_t i = 0; i < trace->size; i++) {
+		worker_t *worker = &workers[trace->ops[i].handle % threads];
+		worker->indexes[worker->size++] = i;
+	}
+
+	// Time the threads from their start until the last one ends
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	pthread_t ids[BENCH_THREADS];
+	for (size_t i = 0; i < threads; i++)
+		DIE(pthread_create(&ids[i], NULL, worker_run, &workers[i]),
+			"Pthread_create failed while starting a thread");
+
+	for (size_t i = 0; i < threads; i++)
+		pthread_join(ids[i], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	// Count the MALLOCs which found no memory, then free everything
+	*failed = 0;
+	for (size_t i = 0; i < threads; i++) {
+		*failed += workers[i].failed;
+		free(workers[i].indexes);
+	}
+
+	free(addresses);
+	sfl_destroy(heap);
+
+	return (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 + end.tv_nsec -
+		   start.tv_nsec;
+}
+
+void scale(const char *path, size_t max_threads)
+{
+	// Read the trace once for every number of threads
+	trace_t trace;
+	if (!trace_load(path, &trace)) {
+		fprintf(stderr, "%s: the trace has no INIT_HEAP\n", path);
+		trace_destroy(&trace);
+		return;
+	}
+
+	if (max_threads > BENCH_THREADS)
+		max_threads = BENCH_THREADS;
+
+	fprintf(stderr, "%s: %lu commands on %lu blocks\n", path, trace.size,
+			trace.handles);
+	fprintf(stderr, "  %-8s %-8s %14s %10s %10s\n", "threads", "mode",
+			"commands/s", "speedup", "failed");
+
+	// Compare every number of threads to one thread of the same mode
+	for (size_t cached = 0; cached <= 1; cached++) {
+		double base = 0;
+
+		for (size_t threads = 1; threads <= max_threads; threads++) {
+			size_t failed;
+			uint64_t time = run_threads(&trace, threads, cached, &failed);
+
+			double throughput = time ? trace.size * 1e9 / time : 0.0;
+			if (threads == 1)
+				base = throughput;
+
+			fprintf(stderr, "  %-8lu %-8s %14.0f %9.2fx %10lu\n", threads,
+					cached ? "cached" : "locked", throughput,
+					base ? throughput / base : 0.0, failed);
+		}
+	}
+
+	trace_destroy(&trace);
+}
@@ -0,0 +1,238 @@
+#include "../header.h"
+
+sfl_heap_t *sfl_init(size_t start_address, size_t lists_num,
+					 size_t bytes_per_list, size_t reconstruct_type)
+{
+	// Allocate the context of the heap
+	sfl_heap_t *heap = malloc(sizeof(sfl_heap_t));
+	DIE(!heap, "Malloc failed while allocating heap");
+
+	// Initialize the lists, along with the heap data
+	heap->sfl = init_heap(lists_num, bytes_per_list);
+	tree_init(&heap->allocated_blocks);
+
+	// Give every freed block back to the lists, until magazines are chosen
+	heap->magazines = NULL;
+	heap->magazine_blocks = 0;
+	tree_init(&heap->cached_blocks);
+
+	// Initialize the memory statistics
+	heap->malloc_calls = 0;
+	heap->free_calls = 0;
+	heap->fragmentations = 0;
+	heap->allocated_memory = 0;
+
+	// Save the parameters of the heap
+	heap->start_address = start_address;
+	heap->bytes_per_list = bytes_per_list;
+	heap->reconstruct_type = reconstruct_type;
+
+	// The buddy system finds the free buddies of a block by its bitmaps
+	if (reconstruct_type == RECONSTRUCT_BUDDY)
+		buddy_init(heap);
+
+	// Take the smallest block that fits, until another policy is chosen
+	heap->policy = SFL_BEST_FIT;
+	heap->next_size = 0;
+
+	// Start an empty profile, shared with the pool and the tree
+	PROFILE(memset(&heap->profile, 0, sizeof(profile_t));)
+	PROFILE(heap->sfl.pool.profile = &heap->profile;)
+	PROFILE(heap->allocated_blocks.profile = &heap->profile;)
+	PROFILE(heap->cached_blocks.profile = &heap->profile;)
+
+	// Initialize the lock, for the heaps shared by many threads
+	pthread_mutex_init(&heap->lock, NULL);
+
+	return heap;
+}
+
+void sfl_set_policy(sfl_heap_t *heap, sfl_policy_t policy)
+{
+	pthread_mutex_lock(&heap->lock);
+	heap->policy = policy;
+	heap->next_size = 0;
+	pthread_mutex_unlock(&heap->lock);
+}
+
+void sfl_set_magazines(sfl_heap_t *heap, int enabled)
+{
+	pthread_mutex_lock(&heap->lock);
+
+	if (enabled && !heap->magazines) {
+		// Start with every magazine empty
+		heap->magazines = calloc(MAGAZINE_MAX_SIZE + 1, sizeof(magazine_t));
+		DIE(!heap->magazines, "Calloc failed while allocating magazines");
+	} else if (!enabled && heap->magazines) {
+		// Give the kept blocks back to the lists before dropping the magazines
+		magazine_flush(heap);
+		free(heap->magazines);
+		heap->magazines = NULL;
+	}
+
+	pthread_mutex_unlock(&heap->lock);
+}
+
+void sfl_destroy(sfl_heap_t *heap)
+{
+	// Free the magazines, whose blocks are part of the heap data
+	free(heap->magazines);
+	tree_destroy(&heap->cached_blocks);
+
+	// Free the lists, the index and the heap data, then the context
+	destroy_heap(&heap->sfl, &heap->allocated_blocks);
+	pthread_mutex_destroy(&heap->lock);
+	free(heap);
+}
+
+size_t sfl_malloc(sfl_heap_t *heap, size_t size)
+{
+	// Allocate the block and turn its offset into an address
+	pthread_mutex_lock(&heap->lock);
+	size_t block_address = malloc_f(heap, size);
+	pthread_mutex_unlock(&heap->lock);
+
+	if (block_address == NO_BLOCK)
+		return 0;
+
+	return block_address + heap->start_address;
+}
+
+size_t sfl_memalign(sfl_heap_t *heap, size_t alignment, size_t size)
+{
+	// Allocate the aligned block and turn its offset into an address
+	pthread_mutex_lock(&heap->lock);
+	size_t block_address = memalign_f(heap, alignment, size);
+	pthread_mutex_unlock(&heap->lock);
+
+	if (block_address == NO_BLOCK)
+		return 0;
+
+	return block_address + heap->start_address;
+}
+
+size_t sfl_calloc(sfl_heap_t *heap, size_t size)
+{
+	// Allocate the block, filled with zeros, and turn its offset into an
+	// address
+	pthread_mutex_lock(&heap->lock);
+	size_t block_address = calloc_f(heap, size);
+	pthread_mutex_unlock(&heap->lock);
+
+	if (block_address == NO_BLOCK)
+		return 0;
+
+	return block_address + heap->start_address;
+}
+
+size_t sfl_realloc(sfl_heap_t *heap, size_t address, size_t size)
+{
+	// Resize or move the block, and turn its new offset into an address
+	size_t block_address;
+	pthread_mutex_lock(&heap->lock);
+	bool found = realloc_f(heap, address, size, &block_address);
+	pthread_mutex_unlock(&heap->lock);
+
+	if (!found || block_address == NO_BLOCK)
+		return 0;
+
+	return block_address + heap->start_address;
+}
+
+int sfl_free(sfl_heap_t *heap, size_t address)
+{
+	pthread_mutex_lock(&heap->lock);
+	bool freed = free_f(heap, address);
+	pthread_mutex_unlock(&heap->lock);
+
+	return freed;
+}
+
+int sfl_read(sfl_heap_t *heap, size_t address, void *buffer, size_t size)
+{
+	// Check that every byte belongs to an allocated block
+	address -= heap->start_address;
+	pthread_mutex_lock(&heap->lock);
+	bool found = find_span(&heap->allocated_blocks, address, size);
+
+	// Copy the bytes at once, since the blocks are contiguous in the heap
+	if (found)
+		memcpy(buffer, (char *)heap->sfl.heap_data + address, size);
+
+	pthread_mutex_unlock(&heap->lock);
+	return found;
+}
+
+int sfl_write(sfl_heap_t *heap, size_t address, const void *data, size_t size)
+{
+	// Check that every byte belongs to an allocated block
+	address -= heap->start_address;
+	pthread_mutex_lock(&heap->lock);
+	bool found = find_span(&heap->allocated_blocks, address, size);
+
+	// Copy the bytes at once, since the blocks are contiguous in the heap
+	if (found)
+		memcpy((char *)heap->sfl.heap_data + address, data, size);
+
+	pthread_mutex_unlock(&heap->lock);
+	return found;
+}
+
+void sfl_stats(sfl_heap_t *heap, sfl_stats_t *stats)
+{
+	sfl_t *sfl = &heap->sfl;
+	pthread_mutex_lock(&heap->lock);
+
+	// Copy the totals, which every change of the lists keeps up to date
+	stats->free_blocks = sfl->free_blocks;
+	stats->free_memory = sfl->free_memory;
+	stats->allocated_memory = heap->allocated_memory;
+	stats->total_memory = stats->free_memory + stats->allocated_memory;
+	stats->allocated_blocks = heap->allocated_blocks.size;
+	stats->malloc_calls = heap->malloc_calls;
+	stats->free_calls = heap->free_calls;
+	stats->fragmentations = heap->fragmentations;
+	stats->wasted_memory = sfl->wasted_memory;
+	stats->policy = heap->policy;
+	stats->resident_memory = sfl->resident_memory;
+	stats->released_memory = sfl->released_memory;
+	memcpy(stats->class_blocks, sfl->class_blocks, sizeof(sfl->class_blocks));
+	memcpy(stats->class_memory, sfl->class_memory, sizeof(sfl->class_memory));
+
+	// The largest free block is the size of the last non-empty list, or of
+	// the last non-empty magazine
+	size_t largest = bitmap_last(&sfl->used);
+	stats->largest_free_block = largest > sfl->max_size ? 0 : largest;
+	if (magazine_last(heap) > stats->largest_free_block)
+		stats->largest_free_block = magazine_last(heap);
+
+	pthread_mutex_unlock(&heap->lock);
+}
+
+size_t sfl_resident(sfl_heap_t *heap)
+{
+	pthread_mutex_lock(&heap->lock);
+	size_t resident = resident_memory(&heap->sfl);
+	pthread_mutex_unlock(&heap->lock);
+
+	return resident;
+}
+
+size_t sfl_regions(sfl_heap_t *heap, sfl_region_t *regions, size_t count)
+{
+	sfl_t *sfl = &heap->sfl;
+	pthread_mutex_lock(&heap->lock);
+
+	// Copy the occupancy of the initial lists which fit in the array
+	for (size_t i = 0; i < sfl->regions_num && i < count; i++) {
+		regions[i].parent_size = 8 * ((size_t)1 << i);
+		regions[i].size = sfl->regions[i].end - i * heap->bytes_per_list;
+		regions[i].allocated_memory = sfl->regions[i].allocated_memory;
+		regions[i].allocated_blocks = sfl->regions[i].allocated_blocks;
+	}
+
+	size_t regions_num = sfl->regions_num;
+	pthread_mutex_unlock(&heap->lock);
+
+	return regions_num;
+}
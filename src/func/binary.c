@@ -0,0 +1,210 @@
+#include "../header.h"
+
+size_t binary_varint(input_t *input)
+{
+	// Add 7 bits from every byte, the highest bit marking that more follow
+	size_t number = 0;
+	for (size_t shift = 0;; shift += 7) {
+		int c = input_peek(input);
+		if (c == EOF)
+			return number;
+
+		input->pos += 1;
+
+		// A malformed number with bits past the 64th saturates, its other
+		// bytes still being skipped
+		size_t bits = c & 0x7f;
+		if (shift >= 64 || (shift && bits >> (64 - shift)))
+			number = SIZE_MAX;
+		else
+			number |= bits << shift;
+
+		if (!(c & 0x80))
+			return number;
+	}
+}
+
+bool binary_magic(input_t *input)
+{
+	// Check the first bytes of the input, one by one
+	for (size_t i = 0; i < sizeof(BINARY_MAGIC) - 1; i++) {
+		// Go back to the start of the input, which is still in the buffer
+		if (input_peek(input) != BINARY_MAGIC[i]) {
+			input->pos = 0;
+			return false;
+		}
+
+		input->pos += 1;
+	}
+
+	return true;
+}
+
+command_t binary_command(input_t *input)
+{
+	// Every command starts with its opcode
+	int c = input_peek(input);
+	if (c == EOF)
+		return COMMAND_EOF;
+
+	input->pos += 1;
+
+	// The opcodes which are not commands are skipped like unknown keywords
+	if (c >= COMMAND_UNKNOWN)
+		return COMMAND_UNKNOWN;
+
+	return c;
+}
+
+size_t binary_text(input_t *input)
+{
+	// The text is prefixed by its length
+	size_t length = binary_varint(input);
+
+	// Keep the text in the buffer, refilling it as many times as needed
+	input_mark(input);
+	while (input->size - input->mark < length) {
+		input->pos = input->size;
+		if (!input_refill(input))
+			break;
+	}
+
+	// Skip the text, which is cut at the end of the input
+	if (length > input->size - input->mark)
+		length = input->size - input->mark;
+	input->pos = input->mark + length;
+
+	return length;
+}
+
+void binary_arguments(input_t *input, command_t command,
+					  arguments_t *arguments)
+{
+	switch (command) {
+	case COMMAND_INIT_HEAP:
+		arguments->address = binary_varint(input);
+		arguments->lists_num = binary_varint(input);
+		arguments->bytes_per_list = binary_varint(input);
+		arguments->reconstruct_type = binary_varint(input);
+		break;
+	case COMMAND_MALLOC:
+	case COMMAND_CALLOC:
+		arguments->size = binary_varint(input);
+		break;
+	case COMMAND_MEMALIGN:
+		arguments->alignment = binary_varint(input);
+		arguments->size = binary_varint(input);
+		break;
+	case COMMAND_FREE:
+		arguments->address = binary_varint(input);
+		break;
+	case COMMAND_READ:
+	case COMMAND_REALLOC:
+		arguments->address = binary_varint(input);
+		arguments->size = binary_varint(input);
+		break;
+	case COMMAND_WRITE:
+		// The text stays in the buffer until the size after it is read
+		arguments->address = binary_varint(input);
+		arguments->text_length = binary_text(input);
+		arguments->size = binary_varint(input);
+		arguments->text = input_release(input);
+		break;
+	case COMMAND_SNAPSHOT:
+	case COMMAND_RESTORE: {
+		// The file is copied, since it has to end with a null byte
+		size_t length = binary_text(input);
+		if (length >= PATH_SIZE)
+			length = PATH_SIZE - 1;
+
+		memcpy(arguments->path, input_release(input), length);
+		arguments->path[length] = '\0';
+		break;
+	}
+	default:
+		// The other commands have no arguments
+		break;
+	}
+}
+
+void binary_put_varint(FILE *output, size_t number)
+{
+	// Write 7 bits in every byte, the highest bit marking that more follow
+	while (number >= 0x80) {
+		fputc((number & 0x7f) | 0x80, output);
+		number >>= 7;
+	}
+
+	fputc(number, output);
+}
+
+void binary_put_text(FILE *output, const char *text, size_t length)
+{
+	// Prefix the text with its length
+	binary_put_varint(output, length);
+	fwrite(text, 1, length, output);
+}
+
+void binary_put_command(FILE *output, command_t command,
+						arguments_t *arguments)
+{
+	// Start with the opcode of the command
+	fputc(command, output);
+
+	switch (command) {
+	case COMMAND_INIT_HEAP:
+		binary_put_varint(output, arguments->address);
+		binary_put_varint(output, arguments->lists_num);
+		binary_put_varint(output, arguments->bytes_per_list);
+		binary_put_varint(output, arguments->reconstruct_type);
+		break;
+	case COMMAND_MALLOC:
+	case COMMAND_CALLOC:
+		binary_put_varint(output, arguments->size);
+		break;
+	case COMMAND_MEMALIGN:
+		binary_put_varint(output, arguments->alignment);
+		binary_put_varint(output, arguments->size);
+		break;
+	case COMMAND_FREE:
+		binary_put_varint(output, arguments->address);
+		break;
+	case COMMAND_READ:
+	case COMMAND_REALLOC:
+		binary_put_varint(output, arguments->address);
+		binary_put_varint(output, arguments->size);
+		break;
+	case COMMAND_WRITE:
+		binary_put_varint(output, arguments->address);
+		binary_put_text(output, arguments->text, arguments->text_length);
+		binary_put_varint(output, arguments->size);
+		break;
+	case COMMAND_SNAPSHOT:
+	case COMMAND_RESTORE:
+		binary_put_text(output, arguments->path, strlen(arguments->path));
+		break;
+	default:
+		// The other commands have no arguments
+		break;
+	}
+}
+
+void binary_convert(input_t *input, FILE *output)
+{
+	// Mark the output as a binary trace
+	fputs(BINARY_MAGIC, output);
+
+	while (true) {
+		// Read the next command, skipping the unknown ones
+		command_t command = input_command(input);
+		if (command == COMMAND_EOF)
+			return;
+		if (command == COMMAND_UNKNOWN)
+			continue;
+
+		// Write the command along with its arguments
+		arguments_t arguments;
+		input_arguments(input, command, &arguments);
+		binary_put_command(output, command, &arguments);
+	}
+}
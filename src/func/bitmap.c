@@ -0,0 +1,125 @@
+#include "../header.h"
+
+void bitmap_init(bitmap_t *bitmap, size_t bits)
+{
+	// Save the number of bits
+	bitmap->bits = bits;
+	bitmap->levels = 0;
+
+	// Add levels until one word summarises the whole bitmap
+	size_t words;
+	do {
+		words = bits ? (bits + 63) / 64 : 1;
+
+		bitmap->counts[bitmap->levels] = bits;
+		bitmap->words[bitmap->levels] = calloc(words, sizeof(uint64_t));
+		DIE(!bitmap->words[bitmap->levels],
+			"Calloc failed while allocating bitmap words");
+
+		bitmap->levels += 1;
+		bits = words;
+	} while (words > 1 && bitmap->levels < BITMAP_LEVELS);
+}
+
+void bitmap_destroy(bitmap_t *bitmap)
+{
+	// Free the words of every level
+	for (size_t level = 0; level < bitmap->levels; level++)
+		free(bitmap->words[level]);
+
+	bitmap->levels = 0;
+	bitmap->bits = 0;
+}
+
+void bitmap_set(bitmap_t *bitmap, size_t index)
+{
+	// Set the bit on every level, the upper ones mark non-zero words
+	for (size_t level = 0; level < bitmap->levels; level++) {
+		uint64_t *word = &bitmap->words[level][index / 64];
+		bool was_empty = !*word;
+
+		*word |= (uint64_t)1 << (index % 64);
+
+		// The upper levels already know about this word
+		if (!was_empty)
+			return;
+
+		index /= 64;
+	}
+}
+
+void bitmap_clear(bitmap_t *bitmap, size_t index)
+{
+	// Clear the bit and propagate upwards only if the word became empty
+	for (size_t level = 0; level < bitmap->levels; level++) {
+		uint64_t *word = &bitmap->words[level][index / 64];
+
+		*word &= ~((uint64_t)1 << (index % 64));
+
+		if (*word)
+			return;
+
+		index /= 64;
+	}
+}
+
+bool bitmap_test(bitmap_t *bitmap, size_t index)
+{
+	return (bitmap->words[0][index / 64] >> (index % 64)) & 1;
+}
+
+size_t bitmap_next(bitmap_t *bitmap, size_t index)
+{
+	// Climb until a word has a set bit at or after the index
+	size_t level = 0;
+	uint64_t word;
+	while (true) {
+		// Nothing can be found past the end of the level
+		if (index >= bitmap->counts[level])
+			return bitmap->bits;
+
+		word = bitmap->words[level][index / 64] &
+			   (~(uint64_t)0 << (index % 64));
+		if (word)
+			break;
+
+		// Continue with the next word, one level higher
+		if (level + 1 == bitmap->levels)
+			return bitmap->bits;
+
+		index = index / 64 + 1;
+		level += 1;
+	}
+
+	// Descend, always taking the first set bit
+	index = index / 64 * 64 + __builtin_ctzll(word);
+	while (level > 0) {
+		level -= 1;
+		index = index * 64 + __builtin_ctzll(bitmap->words[level][index]);
+	}
+
+	return index;
+}
+
+size_t bitmap_last(bitmap_t *bitmap)
+{
+	// Find the last non-empty word of the top level
+	size_t level = bitmap->levels - 1;
+	size_t index = (bitmap->counts[level] + 63) / 64;
+	while (index && !bitmap->words[level][index - 1])
+		index -= 1;
+
+	// The bitmap is empty if the top level is
+	if (!index)
+		return bitmap->bits;
+
+	// Descend, always taking the last set bit
+	index -= 1;
+	while (true) {
+		index = index * 64 + 63 - __builtin_clzll(bitmap->words[level][index]);
+		if (!level)
+			return index;
+
+		level -= 1;
+	}
+}
@@ -0,0 +1,191 @@
+#include "../header.h"
+
+void pool_init(pool_t *pool)
+{
+	// Start with no records, they are allocated on the first use
+	pool->blocks = NULL;
+	pool->capacity = 0;
+	pool->free_head = NO_BLOCK;
+	pool->table = NULL;
+	pool->table_size = 0;
+	pool->used = 0;
+}
+
+void pool_destroy(pool_t *pool)
+{
+	// Free all the records at once, along with their table
+	free(pool->blocks);
+	free(pool->table);
+	pool_init(pool);
+}
+
+size_t pool_alloc(pool_t *pool)
+{
+	// Grow the pool if every record is used
+	if (pool->free_head == NO_BLOCK) {
+		size_t capacity = pool->capacity ? 2 * pool->capacity : POOL_SIZE;
+
+		pool->blocks = realloc(pool->blocks, capacity * sizeof(block_t));
+		DIE(!pool->blocks, "Realloc failed while reallocating pool blocks");
+		PROFILE(pool->profile->growths[GROWTH_POOL] += 1;)
+
+		// Link the new records, so the lowest index is used first
+		for (size_t i = capacity; i > pool->capacity; i--) {
+			pool->blocks[i - 1].next = pool->free_head;
+			pool->free_head = i - 1;
+		}
+
+		pool->capacity = capacity;
+	}
+
+	// Take the first unused record
+	size_t index = pool->free_head;
+	pool->free_head = pool->blocks[index].next;
+
+	return index;
+}
+
+void pool_free(pool_t *pool, size_t index)
+{
+	// Put the record back in front of the unused ones
+	pool->blocks[index].next = pool->free_head;
+	pool->free_head = index;
+}
+
+size_t pool_hash(pool_t *pool, size_t address)
+{
+	// Spread the addresses over the table, whose size is a power of two
+	return (size_t)(((uint64_t)address * 0x9e3779b97f4a7c15) >> 32) &
+		   (pool->table_size - 1);
+}
+
+void pool_rehash(pool_t *pool, size_t table_size)
+{
+	// Keep the old table until all of its records are moved
+	size_t *table = pool->table;
+	size_t old_size = pool->table_size;
+
+	pool->table = malloc(table_size * sizeof(size_t));
+	DIE(!pool->table, "Malloc failed while allocating pool table");
+	pool->table_size = table_size;
+	PROFILE(pool->profile->growths[GROWTH_TABLE] += 1;)
+
+	// Start with every slot empty
+	for (size_t i = 0; i < table_size; i++)
+		pool->table[i] = NO_BLOCK;
+
+	// Move every record to its slot in the new table
+	for (size_t i = 0; i < old_size; i++) {
+		if (table[i] == NO_BLOCK)
+			continue;
+
+		size_t slot = pool_hash(pool, pool->blocks[table[i]].address);
+		while (pool->table[slot] != NO_BLOCK)
+			slot = (slot + 1) & (table_size - 1);
+
+		pool->table[slot] = table[i];
+	}
+
+	free(table);
+}
+
+void pool_insert(pool_t *pool, size_t index)
+{
+	// Grow the table while it is more than half full
+	if (2 * (pool->used + 1) > pool->table_size)
+		pool_rehash(pool, pool->table_size ? 2 * pool->table_size :
+											 2 * POOL_SIZE);
+
+	// Put the record in the first empty slot from its hash
+	size_t slot = pool_hash(pool, pool->blocks[index].address);
+	while (pool->table[slot] != NO_BLOCK)
+		slot = (slot + 1) & (pool->table_size - 1);
+
+	pool->table[slot] = index;
+	pool->used += 1;
+}
+
+size_t pool_find(pool_t *pool, size_t address)
+{
+	// An empty table holds no record
+	if (!pool->used)
+		return NO_BLOCK;
+
+	// Probe from the hash of the address until an empty slot
+	PROFILE(size_t steps = 0;)
+	for (size_t slot = pool_hash(pool, address); pool->table[slot] != NO_BLOCK;
+		 slot = (slot + 1) & (pool->table_size - 1)) {
+		PROFILE(steps += 1;)
+
+		if (pool->blocks[pool->table[slot]].address == address) {
+			PROFILE(histogram_add(&pool->profile->walks[WALK_POOL], steps);)
+			return pool->table[slot];
+		}
+	}
+
+	PROFILE(histogram_add(&pool->profile->walks[WALK_POOL], steps);)
+	return NO_BLOCK;
+}
+
+void pool_erase(pool_t *pool, size_t index)
+{
+	size_t mask = pool->table_size - 1;
+
+	// Find the slot of the record
+	size_t slot = pool_hash(pool, pool->blocks[index].address);
+	while (pool->table[slot] != index)
+		slot = (slot + 1) & mask;
+
+	// Shift back the records after it, so no probe sequence is broken
+	for (size_t next = (slot + 1) & mask; pool->table[next] != NO_BLOCK;
+		 next = (next + 1) & mask) {
+		size_t home = pool_hash(pool, pool->blocks[pool->table[next]].address);
+
+		// Move the record only if its home is not between the hole and it
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			pool->table[slot] = pool->table[next];
+			slot = next;
+		}
+	}
+
+	pool->table[slot] = NO_BLOCK;
+	pool->used -= 1;
+}
+
+block_t *free_block(sfl_t *sfl, size_t size, size_t node)
+{
+	// Large blocks keep their header inside the heap, at the first aligned
+	// offset of the block
+	if (size >= MIN_INTRUSIVE_SIZE)
+		return (block_t *)((char *)sfl->heap_data + ALIGN_UP(node));
+
+	// Small blocks are kept in the pool
+	return &sfl->pool.blocks[node];
+}
+
+region_t *find_region(sfl_t *sfl, size_t size)
+{
+	// Only the initial lists have uncarved blocks, of 8 * 2 ^ i bytes
+	if (size < 8 || (size & (size - 1)))
+		return NULL;
+
+	// Find the index of the initial list
+	size_t i = __builtin_ctzll(size) - 3;
+	if (i >= sfl->regions_num)
+		return NULL;
+
+	return &sfl->regions[i];
+}
+
+list_t *find_list(sfl_t *sfl, size_t size)
+{
+	// Allocate the page of the list the first time one of its sizes is used,
+	// every list starting empty (all zeros)
+	list_t **page = &sfl->lists[size / LIST_PAGE_SIZE];
+	if (!*page) {
+		*page = calloc(LIST_PAGE_SIZE, sizeof(list_t));
+		DIE(!*page, "Calloc failed while allocating a page of lists");
+	}
+
+	return &(*page)[size % LIST_PAGE_SIZE];
+}
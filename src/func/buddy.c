@@ -0,0 +1,248 @@
+#include "../header.h"
+
+void buddy_init(sfl_heap_t *heap)
+{
+	sfl_t *sfl = &heap->sfl;
+
+	// Only the blocks smaller than the largest parent block can have a buddy,
+	// so there is a bitmap for the orders of 8 to 8 * 2 ^ (lists_num - 2) bytes
+	sfl->orders_num = sfl->regions_num - 1;
+	sfl->buddies = malloc(sfl->orders_num * sizeof(bitmap_t));
+	DIE(sfl->orders_num && !sfl->buddies,
+		"Malloc failed while allocating sfl->buddies");
+
+	// Every initial list has room for the blocks of every order
+	for (size_t order = 0; order < sfl->orders_num; order++) {
+		size_t size = (size_t)8 << order;
+		size_t stride = (heap->bytes_per_list + size - 1) / size;
+		bitmap_init(&sfl->buddies[order], sfl->regions_num * stride);
+	}
+}
+
+void buddy_destroy(sfl_t *sfl)
+{
+	// Free the bitmap of every order
+	for (size_t order = 0; order < sfl->orders_num; order++)
+		bitmap_destroy(&sfl->buddies[order]);
+
+	free(sfl->buddies);
+	sfl->buddies = NULL;
+	sfl->orders_num = 0;
+}
+
+size_t buddy_index(sfl_heap_t *heap, size_t block_address, size_t block_size)
+{
+	// The blocks of an order are aligned to their size inside their initial
+	// list, which gets the same number of bits for every order
+	size_t list = block_address / heap->bytes_per_list;
+	size_t stride = (heap->bytes_per_list + block_size - 1) / block_size;
+
+	return list * stride + block_address % heap->bytes_per_list / block_size;
+}
+
+void buddy_mark(sfl_heap_t *heap, size_t block_address, size_t block_size,
+				bool added)
+{
+	// The parent blocks have no buddy, so they are never searched for
+	size_t list = block_address / heap->bytes_per_list;
+	if (block_size >= (size_t)8 << list)
+		return;
+
+	bitmap_t *bitmap = &heap->sfl.buddies[__builtin_ctzll(block_size) - 3];
+	size_t index = buddy_index(heap, block_address, block_size);
+
+	if (added)
+		bitmap_set(bitmap, index);
+	else
+		bitmap_clear(bitmap, index);
+}
+
+size_t buddy_malloc(sfl_heap_t *heap, size_t block_size)
+{
+	sfl_t *sfl = &heap->sfl;
+
+	// Nothing larger than the largest parent block can be allocated
+	if (block_size > sfl->max_size)
+		return NO_BLOCK;
+
+	// Round the block up to a power of two, of at least 8 bytes
+	size_t size = 8;
+	while (size < block_size)
+		size <<= 1;
+
+	// Reuse a block of the rounded size which was freed recently
+	size_t block_address = magazine_malloc(heap, size);
+	if (block_address != NO_BLOCK)
+		return block_address;
+
+	// Every free block is a power of two, so the first non-empty list which
+	// fits has the smallest order, the blocks of the magazines being given
+	// back to the lists if none fits
+	size_t i = bitmap_next(&sfl->used, size);
+	if (i > sfl->max_size && heap->magazine_blocks) {
+		magazine_flush(heap);
+		i = bitmap_next(&sfl->used, size);
+	}
+
+	if (i > sfl->max_size)
+		return NO_BLOCK;
+
+	// Count valid malloc calls
+	heap->malloc_calls += 1;
+
+	// Take the block, which is no longer free, and count the allocated
+	// memory, which is the whole block given
+	block_address = add_ll_node(sfl, i, size, &heap->allocated_blocks);
+	buddy_mark(heap, block_address, i, false);
+	count_allocated_block(heap, block_address, size, true);
+
+	// Split the block in halves until it has the rounded size, the upper
+	// halves staying free
+	while (i > size) {
+		i /= 2;
+		heap->fragmentations += 1;
+
+		add_sfl_node(block_address + i, i, sfl);
+		buddy_mark(heap, block_address + i, i, true);
+	}
+
+	return block_address;
+}
+
+size_t buddy_memalign(sfl_heap_t *heap, size_t alignment, size_t block_size)
+{
+	sfl_t *sfl = &heap->sfl;
+
+	// No block is larger than the largest initial block, and rounding a
+	// larger size could overflow
+	if (block_size > sfl->max_size)
+		return NO_BLOCK;
+
+	// Round the block up to a power of two, of at least 8 bytes
+	size_t size = 8;
+	while (size < block_size)
+		size <<= 1;
+
+	// Find the smallest free block with an aligned half (or quarter...) of
+	// the rounded size, giving the blocks of the magazines back to the lists
+	// if there is none
+	size_t i, block_address = NO_BLOCK;
+	for (size_t tries = 0; tries < 2 && block_address == NO_BLOCK; tries++) {
+		if (tries && !heap->magazine_blocks)
+			break;
+		if (tries)
+			magazine_flush(heap);
+
+		for (i = bitmap_next(&sfl->used, size); i <= sfl->max_size;
+			 i = bitmap_next(&sfl->used, i + 1)) {
+			block_address = find_aligned(heap, i, alignment, size, size);
+			if (block_address != NO_BLOCK)
+				break;
+		}
+	}
+
+	if (block_address == NO_BLOCK)
+		return NO_BLOCK;
+
+	heap->malloc_calls += 1;
+
+	// Take the block, which is no longer free
+	take_free_block(sfl, i, block_address);
+	buddy_mark(heap, block_address, i, false);
+
+	// Split the block in halves until it has the rounded size, keeping the
+	// half with the aligned range and freeing the other one
+	size_t aligned = block_address + align_offset(heap, block_address, alignment);
+	while (i > size) {
+		i /= 2;
+		heap->fragmentations += 1;
+
+		size_t half = aligned < block_address + i ? block_address + i :
+													block_address;
+		add_sfl_node(half, i, sfl);
+		buddy_mark(heap, half, i, true);
+
+		if (half == block_address)
+			block_address += i;
+	}
+
+	// The allocated block holds the whole rounded size
+	tree_insert(&heap->allocated_blocks, block_address, size);
+	count_allocated_block(heap, block_address, size, true);
+
+	return block_address;
+}
+
+bool buddy_resize(sfl_heap_t *heap, size_t node, size_t new_size)
+{
+	tree_node_t *block = &heap->allocated_blocks.nodes[node];
+	size_t block_address = block->address;
+	size_t block_size = block->size;
+
+	// No block is larger than the largest initial block, and rounding a
+	// larger size could overflow
+	if (new_size > heap->sfl.max_size)
+		return false;
+
+	// Round the new size up to a power of two, of at least 8 bytes
+	size_t size = 8;
+	while (size < new_size)
+		size <<= 1;
+
+	// A block can only grow by moving, since its buddy is split from it
+	if (size > block_size)
+		return false;
+
+	// Count the allocated memory with the new size of the block
+	count_allocated_block(heap, block_address, block_size, false);
+	block->size = size;
+	count_allocated_block(heap, block_address, size, true);
+
+	// Split the block in halves until it has the rounded size, the upper
+	// halves becoming free, while their buddies stay allocated
+	while (block_size > size) {
+		block_size /= 2;
+		heap->fragmentations += 1;
+
+		add_sfl_node(block_address + block_size, block_size, &heap->sfl);
+		buddy_mark(heap, block_address + block_size, block_size, true);
+	}
+
+	return true;
+}
+
+void buddy_free(sfl_heap_t *heap, size_t block_address, size_t block_size)
+{
+	sfl_t *sfl = &heap->sfl;
+
+	// Blocks are only united inside their parent block
+	size_t parent_start, parent_end;
+	find_parent(block_address, heap->bytes_per_list, &parent_start,
+				&parent_end);
+
+	// Unite the block with its buddy while the buddy is a free block of the
+	// same size, one order at a time
+	PROFILE(size_t merges = 0;)
+	while (block_size < parent_end - parent_start) {
+		size_t buddy = parent_start +
+					   ((block_address - parent_start) ^ block_size);
+
+		bitmap_t *bitmap = &sfl->buddies[__builtin_ctzll(block_size) - 3];
+		if (!bitmap_test(bitmap, buddy_index(heap, buddy, block_size)))
+			break;
+
+		remove_free_block(sfl, buddy, block_size);
+		buddy_mark(heap, buddy, block_size, false);
+
+		if (buddy < block_address)
+			block_address = buddy;
+		block_size *= 2;
+		PROFILE(merges += 1;)
+	}
+	PROFILE(histogram_add(&heap->profile.merges, merges);)
+
+	// Free the united block and release the pages it covers
+	add_sfl_node(block_address, block_size, sfl);
+	buddy_mark(heap, block_address, block_size, true);
+	release_pages(sfl, block_address, block_size);
+}
@@ -0,0 +1,195 @@
+#include "../header.h"
+
+size_t cache_hash(sfl_cache_t *cache, size_t address)
+{
+	// Spread the addresses over the table, whose size is a power of two
+	return (size_t)(((uint64_t)address * 0x9e3779b97f4a7c15) >> 32) &
+		   (cache->table_size - 1);
+}
+
+void cache_rehash(sfl_cache_t *cache, size_t table_size)
+{
+	// Keep the old table until all of its blocks are moved
+	cache_entry_t *table = cache->table;
+	size_t old_size = cache->table_size;
+
+	cache->table = calloc(table_size, sizeof(cache_entry_t));
+	DIE(!cache->table, "Calloc failed while allocating cache table");
+	cache->table_size = table_size;
+
+	// Move every block to its slot in the new table
+	for (size_t i = 0; i < old_size; i++) {
+		if (!table[i].address)
+			continue;
+
+		size_t slot = cache_hash(cache, table[i].address);
+		while (cache->table[slot].address)
+			slot = (slot + 1) & (table_size - 1);
+
+		cache->table[slot] = table[i];
+	}
+
+	free(table);
+}
+
+void cache_insert(sfl_cache_t *cache, size_t address, size_t size_class)
+{
+	// Grow the table while it is more than half full
+	if (2 * (cache->used + 1) > cache->table_size)
+		cache_rehash(cache, 2 * cache->table_size);
+
+	// Put the block in the first empty slot from its hash
+	size_t slot = cache_hash(cache, address);
+	while (cache->table[slot].address)
+		slot = (slot + 1) & (cache->table_size - 1);
+
+	cache->table[slot].address = address;
+	cache->table[slot].size_class = size_class;
+	cache->used += 1;
+}
+
+size_t cache_erase(sfl_cache_t *cache, size_t address)
+{
+	size_t mask = cache->table_size - 1;
+
+	// Find the slot of the block, the blocks of other caches not being there
+	size_t slot = cache_hash(cache, address);
+	while (cache->table[slot].address != address) {
+		if (!cache->table[slot].address)
+			return CACHE_CLASSES;
+
+		slot = (slot + 1) & mask;
+	}
+	size_t size_class = cache->table[slot].size_class;
+
+	// Shift back the blocks after it, so no probe sequence is broken
+	for (size_t next = (slot + 1) & mask; cache->table[next].address;
+		 next = (next + 1) & mask) {
+		size_t home = cache_hash(cache, cache->table[next].address);
+
+		// Move the block only if its home is not between the hole and it
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			cache->table[slot] = cache->table[next];
+			slot = next;
+		}
+	}
+
+	cache->table[slot].address = 0;
+	cache->used -= 1;
+
+	return size_class;
+}
+
+size_t cache_refill(sfl_cache_t *cache, size_t size_class)
+{
+	sfl_heap_t *heap = cache->heap;
+	size_t *magazine = cache->magazines[size_class];
+
+	// Allocate half of a magazine at once, while holding the lock only once
+	pthread_mutex_lock(&heap->lock);
+	while (cache->counts[size_class] < MAGAZINE_SIZE / 2) {
+		size_t block_address = malloc_f(heap, 8 * (size_class + 1));
+		if (block_address == NO_BLOCK)
+			break;
+
+		magazine[cache->counts[size_class]++] =
+			block_address + heap->start_address;
+	}
+	pthread_mutex_unlock(&heap->lock);
+
+	return cache->counts[size_class];
+}
+
+void cache_drain(sfl_cache_t *cache, size_t size_class, size_t count)
+{
+	sfl_heap_t *heap = cache->heap;
+	size_t *magazine = cache->magazines[size_class];
+
+	// Free the oldest blocks at once, while holding the lock only once
+	pthread_mutex_lock(&heap->lock);
+	for (size_t i = 0; i < count; i++)
+		free_f(heap, magazine[i]);
+	pthread_mutex_unlock(&heap->lock);
+
+	// Move the newest blocks to the start of the magazine
+	cache->counts[size_class] -= count;
+	memmove(magazine, magazine + count,
+			cache->counts[size_class] * sizeof(size_t));
+}
+
+sfl_cache_t *sfl_cache_create(sfl_heap_t *heap)
+{
+	// Allocate the cache, with every magazine empty
+	sfl_cache_t *cache = calloc(1, sizeof(sfl_cache_t));
+	DIE(!cache, "Calloc failed while allocating cache");
+
+	cache->heap = heap;
+
+	// Allocate the table of the blocks given by the cache
+	cache->table_size = 2 * POOL_SIZE;
+	cache->table = calloc(cache->table_size, sizeof(cache_entry_t));
+	DIE(!cache->table, "Calloc failed while allocating cache table");
+
+	return cache;
+}
+
+void sfl_cache_destroy(sfl_cache_t *cache)
+{
+	// Give the blocks of every magazine back to the heap
+	for (size_t i = 0; i < CACHE_CLASSES; i++)
+		if (cache->counts[i])
+			cache_drain(cache, i, cache->counts[i]);
+
+	free(cache->table);
+	free(cache);
+}
+
+size_t sfl_cache_malloc(sfl_cache_t *cache, size_t size)
+{
+	// Do nothing for malloc(0)
+	if (!size)
+		return 0;
+
+	// The blocks larger than the cached classes come from the heap directly
+	size_t size_class = (size - 1) / 8;
+	if (size_class >= CACHE_CLASSES)
+		return sfl_malloc(cache->heap, size);
+
+	// Refill an empty magazine from the heap, giving the blocks of the other
+	// magazines back first if the heap has no memory left for it
+	if (!cache->counts[size_class] && !cache_refill(cache, size_class)) {
+		for (size_t i = 0; i < CACHE_CLASSES; i++)
+			if (cache->counts[i])
+				cache_drain(cache, i, cache->counts[i]);
+
+		if (!cache_refill(cache, size_class))
+			return 0;
+	}
+
+	// Take the newest block of the magazine and remember its class
+	size_t address = cache->magazines[size_class][--cache->counts[size_class]];
+	cache_insert(cache, address, size_class);
+
+	return address;
+}
+
+int sfl_cache_free(sfl_cache_t *cache, size_t address)
+{
+	// Do nothing for free(NULL)
+	if (!address)
+		return true;
+
+	// The blocks which were not given by the cache are freed in the heap
+	size_t size_class = cache_erase(cache, address);
+	if (size_class == CACHE_CLASSES)
+		return sfl_free(cache->heap, address);
+
+	// Make room in a full magazine by giving half of it back to the heap
+	if (cache->counts[size_class] == MAGAZINE_SIZE)
+		cache_drain(cache, size_class, MAGAZINE_SIZE / 2);
+
+	// Keep the block as the newest of its magazine
+	cache->magazines[size_class][cache->counts[size_class]++] = address;
+
+	return true;
+}
@@ -0,0 +1,169 @@
+// clock_gettime() is not part of C99, only the profiled build times commands
+#ifdef SFL_PROFILE
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#endif
+
+#include "../header.h"
+
+bool execute_command(sfl_heap_t **heap, command_t command,
+					 arguments_t *arguments)
+{
+	// Nothing but INIT_HEAP and RESTORE can be done before the heap exists
+	if (!*heap && command != COMMAND_INIT_HEAP && command != COMMAND_RESTORE)
+		return command != COMMAND_DESTROY_HEAP && command != COMMAND_EOF;
+
+	switch (command) {
+	case COMMAND_INIT_HEAP:
+		// Initialize the heap
+		*heap = sfl_init(arguments->address, arguments->lists_num,
+						 arguments->bytes_per_list,
+						 arguments->reconstruct_type);
+		sfl_set_policy(*heap, arguments->policy);
+		sfl_set_magazines(*heap, arguments->magazines);
+		return true;
+	case COMMAND_MALLOC:
+		// Allocate memory, or print an error message if there is not enough
+		if (malloc_f(*heap, arguments->size) == NO_BLOCK && arguments->size)
+			printf("Out of memory\n");
+		return true;
+	case COMMAND_FREE:
+		// Free memory, or print an error message if the block was not found
+		if (!free_f(*heap, arguments->address))
+			printf("Invalid free\n");
+		return true;
+	case COMMAND_REALLOC: {
+		// Resize the block, or print an error message if it was not found or
+		// there is not enough memory to move it
+		size_t block_address;
+		if (!realloc_f(*heap, arguments->address, arguments->size,
+					   &block_address))
+			printf("Invalid realloc\n");
+		else if (block_address == NO_BLOCK && arguments->size)
+			printf("Out of memory\n");
+		return true;
+	}
+	case COMMAND_MEMALIGN: {
+		// Allocate an aligned block, or print an error message if the
+		// alignment is not a power of two or there is not enough memory
+		size_t alignment = arguments->alignment;
+		if (!alignment || (alignment & (alignment - 1)))
+			printf("Invalid alignment\n");
+		else if (memalign_f(*heap, alignment, arguments->size) == NO_BLOCK &&
+				 arguments->size)
+			printf("Out of memory\n");
+		return true;
+	}
+	case COMMAND_CALLOC:
+		// Allocate zeroed memory, or print an error message if there is not
+		// enough
+		if (calloc_f(*heap, arguments->size) == NO_BLOCK && arguments->size)
+			printf("Out of memory\n");
+		return true;
+	case COMMAND_READ:
+		// Read the block
+		return read(*heap, arguments->address, arguments->size);
+	case COMMAND_WRITE:
+		// Write the block
+		return write(*heap, arguments->address, arguments->text,
+					 arguments->text_length, arguments->size);
+	case COMMAND_DUMP_MEMORY:
+		// Dump the memory statistics
+		dump_memory(*heap);
+		return true;
+	case COMMAND_STATS:
+		// Print the totals of the heap
+		print_stats(*heap);
+		return true;
+	case COMMAND_SNAPSHOT:
+		// Save the heap, or print an error message if the file was not written
+		if (!sfl_snapshot(*heap, arguments->path))
+			printf("Snapshot failed\n");
+		return true;
+	case COMMAND_RESTORE: {
+		// Replace the heap with the saved one, keeping it if the file is not a
+		// valid snapshot
+		sfl_heap_t *restored = sfl_restore(arguments->path);
+		if (!restored) {
+			printf("Invalid snapshot\n");
+			return true;
+		}
+
+		if (*heap)
+			sfl_destroy(*heap);
+		*heap = restored;
+		return true;
+	}
+	case COMMAND_FRAG_REPORT:
+		// Print how the free memory is spread
+		print_frag_report(*heap);
+		return true;
+	case COMMAND_PROFILE:
+		// Print the latencies and the walks counted so far
+		print_profile(*heap);
+		return true;
+	case COMMAND_DESTROY_HEAP:
+	case COMMAND_EOF:
+		// Destroy the heap, also when the input ends without the command,
+		// printing its profile for the last time
+		PROFILE(print_profile(*heap);)
+		sfl_destroy(*heap);
+		return false;
+	default:
+		// Ignore the words which are not commands
+		return true;
+	}
+}
+
+bool run_command(sfl_heap_t **heap, input_t *input, command_t command)
+{
+	// Parse the arguments of the command, in the format of the input
+	arguments_t arguments;
+	input_arguments(input, command, &arguments);
+
+	// Execute the command, whose text is still in the buffer of the input
+#ifdef SFL_PROFILE
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
+
+	bool running = execute_command(heap, command, &arguments);
+
+#ifdef SFL_PROFILE
+	// Count the latency in the heap, unless the command destroyed it
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (running && *heap && command < COMMAND_EOF)
+		histogram_add(&(*heap)->profile.latencies[command],
+					  (size_t)(end.tv_sec - start.tv_sec) * 1000000000 +
+						  end.tv_nsec - start.tv_nsec);
+#endif
+
+	return running;
+}
+
+void run(FILE *file, bool binary, sfl_policy_t policy, bool magazines)
+{
+	// The heap is created by INIT_HEAP
+	sfl_heap_t *heap = NULL;
+
+	// Read the commands from the file in large blocks
+	input_t input;
+	input_init(&input, file);
+	input.binary = binary;
+	input.policy = policy;
+	input.magazines = magazines;
+
+	// Check that a binary trace starts as expected
+	if (binary && !binary_magic(&input)) {
+		fprintf(stderr, "The input is not a binary trace\n");
+		input_destroy(&input);
+		return;
+	}
+
+	// Execute the commands until the program has to stop
+	while (run_command(&heap, &input, input_command(&input)))
+		;
+
+	// Free the memory of the input
+	input_destroy(&input);
+}
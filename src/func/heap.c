@@ -1,94 +1,203 @@
-#include "../header.h"
-
-list_t *init_heap(size_t heap_start, size_t lists_num, size_t bytes_per_list,
-				  void **heap_data)
-{
-	// Allocate memory for the heap
-	*heap_data = malloc(lists_num * bytes_per_list);
-	DIE(!*heap_data, "Malloc failed while allocating heap_data");
+// mmap(), madvise() and mincore() are not part of C99
+#define _DEFAULT_SOURCE
 
-	// Set the starting address of the heap
-	heap_start = (size_t)*heap_data;
+#include <sys/mman.h>
 
-	// Allocate memory for the segregated free lists
-	list_t *sfl_lists = malloc(sizeof(list_t) * lists_num);
-	DIE(!sfl_lists, "Malloc failed while allocating sfl_lists");
+#include "../header.h"
 
-	// Initialize each segregated free list
+sfl_t init_heap(size_t lists_num, size_t bytes_per_list)
+{
+	sfl_t sfl;
+
+	// Reserve the memory for the heap, its pages only taking memory once they
+	// are touched
+	sfl.heap_size = lists_num * bytes_per_list;
+	sfl.heap_data = mmap(NULL, sfl.heap_size, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	DIE(sfl.heap_data == MAP_FAILED, "Mmap failed while mapping heap_data");
+
+	// No page is in memory before a block is carved from it
+	size_t pages = (sfl.heap_size + HEAP_PAGE_SIZE - 1) / HEAP_PAGE_SIZE;
+	bitmap_init(&sfl.touched, pages);
+	bitmap_init(&sfl.released, pages);
+	sfl.resident_memory = 0;
+	sfl.released_memory = 0;
+
+	// The largest block is the one of the last list which holds a block,
+	// since no free block grows past its parent block
+	sfl.max_size = 8;
+	for (size_t i = 1; i < lists_num && sfl.max_size * 2 <= bytes_per_list;
+		 i++)
+		sfl.max_size *= 2;
+
+	// Allocate one segregated free list for every possible block size, in
+	// pages which are only allocated once one of their sizes is used, so the
+	// lists take memory for the sizes in use rather than for every size
+	sfl.list_pages = sfl.max_size / LIST_PAGE_SIZE + 1;
+	sfl.lists = calloc(sfl.list_pages, sizeof(list_t *));
+	DIE(!sfl.lists, "Calloc failed while allocating sfl.lists");
+	bitmap_init(&sfl.used, sfl.max_size + 1);
+	sfl.lists_num = 0;
+
+	// The large free blocks keep their metadata inside the heap, the small
+	// ones inside the pool
+	pool_init(&sfl.pool);
+
+	// Start with no free blocks
+	sfl.free_memory = 0;
+	sfl.free_blocks = 0;
+	sfl.wasted_memory = 0;
+
+	// The bitmaps of the buddy system are only allocated for its heaps
+	sfl.buddies = NULL;
+	sfl.orders_num = 0;
+	memset(sfl.class_blocks, 0, sizeof(sfl.class_blocks));
+	memset(sfl.class_memory, 0, sizeof(sfl.class_memory));
+
+	// Allocate the uncarved part of every initial list
+	sfl.regions_num = lists_num;
+	sfl.regions = malloc(lists_num * sizeof(region_t));
+	DIE(!sfl.regions, "Malloc failed while allocating sfl.regions");
+
+	// Initialize each segregated free list, its blocks are carved from the
+	// heap only when they are allocated
 	for (size_t i = 0; i < lists_num; i++) {
 		// Calculate the element size and size of the current list
-		size_t element_size = 8 * (1 << i);
-		sfl_lists[i].size = bytes_per_list / element_size;
-
-		// Create the head node for the current list
-		node_t *previous = malloc(sizeof(node_t));
-		DIE(!previous, "Malloc failed while allocating node for sfl_lists[i]");
-		previous->data = malloc(sizeof(block_t));
-		DIE(!previous->data,
-			"Malloc failed while allocating data for sfl_lists[i]");
-
-		((block_t *)(previous->data))->address =
-			(void *)(heap_start + i * bytes_per_list);
-		((block_t *)(previous->data))->size = element_size;
-
-		sfl_lists[i].head = previous;
-		previous->prev = NULL;
-
-		// Create the remaining nodes for the current list
-		for (size_t j = 1; j < sfl_lists[i].size; j++) {
-			node_t *current = malloc(sizeof(node_t));
-			DIE(!current,
-				"Malloc failed while allocating node for sfl_lists[i]");
-
-			// Set the data of the current node
-			current->data = malloc(sizeof(block_t));
-			DIE(!current->data,
-				"Malloc failed while allocating data for sfl_lists[i]");
-			((block_t *)(current->data))->address =
-				(void *)(heap_start + i * bytes_per_list + j * element_size);
-			((block_t *)(current->data))->size = element_size;
-
-			// Connect the current node to the previous one
-			previous->next = current;
-			current->prev = previous;
-
-			// Move
-			previous = current;
-		}
-
-		// Set the next pointer of the last node to NULL
-		previous->next = NULL;
+		size_t element_size = 8 * ((size_t)1 << i);
+		size_t blocks = element_size <= sfl.max_size ?
+							bytes_per_list / element_size :
+							0;
+
+		// Every block of the list is uncarved
+		sfl.regions[i].next = i * bytes_per_list;
+		sfl.regions[i].end = i * bytes_per_list + blocks * element_size;
+		sfl.regions[i].allocated_memory = 0;
+		sfl.regions[i].allocated_blocks = 0;
+		sfl.regions[i].touched = sfl.regions[i].next;
+
+		// Skip the lists which cannot hold a single block
+		if (!blocks)
+			continue;
+
+		list_t *list = find_list(&sfl, element_size);
+		list->size = blocks;
+
+		// Count the blocks of the list as free
+		count_free_blocks(&sfl, element_size, list->size, true);
+
+		// Mark the list as non-empty
+		bitmap_set(&sfl.used, element_size);
+		sfl.lists_num += 1;
 	}
 
-	return sfl_lists;
+	return sfl;
 }
 
-void destroy_heap(list_t *sfl_lists, size_t lists_num, void *heap_data,
-				  list_t allocated_blocks)
+void destroy_heap(sfl_t *sfl, tree_t *allocated_blocks)
 {
-	// Free the memory of the segregated free lists's nodes
-	for (size_t i = 0; i < lists_num; i++) {
-		node_t *current = sfl_lists[i].head;
-		while (current) {
-			node_t *next = current->next;
-			free(current->data);
-			free(current);
-			current = next;
-		}
+	// Free the memory of the segregated free lists and their bitmap
+	for (size_t i = 0; i < sfl->list_pages; i++)
+		free(sfl->lists[i]);
+	free(sfl->lists);
+	bitmap_destroy(&sfl->used);
+
+	// Free the states of the pages of the heap data
+	bitmap_destroy(&sfl->touched);
+	bitmap_destroy(&sfl->released);
+
+	// Free the records of the small free blocks
+	pool_destroy(&sfl->pool);
+
+	// Free the index of the allocated blocks
+	tree_destroy(allocated_blocks);
+
+	// Free the uncarved parts of the initial lists
+	free(sfl->regions);
+
+	// Free the bitmaps of the buddy system
+	buddy_destroy(sfl);
+
+	// Unmap the memory of the heap, along with the metadata of the large free
+	// blocks
+	munmap(sfl->heap_data, sfl->heap_size);
+}
+
+void release_pages(sfl_t *sfl, size_t block_address, size_t block_size)
+{
+	// A large free block keeps its header inside its first page, which must
+	// stay in memory
+	size_t start = block_address;
+	if (block_size >= MIN_INTRUSIVE_SIZE)
+		start = ALIGN_UP(block_address) + sizeof(block_t);
+
+	// Only the whole pages of the block are released
+	start = (start + HEAP_PAGE_SIZE - 1) & ~(size_t)(HEAP_PAGE_SIZE - 1);
+	size_t end = (block_address + block_size) & ~(size_t)(HEAP_PAGE_SIZE - 1);
+	if (start >= end)
+		return;
+
+	// The pages come back filled with zeros when the block is used, except
+	// for a heap loaded by sfl_restore(), whose private mapping of the file
+	// brings back the bytes of the snapshot, so calloc_f() still has to
+	// clear the blocks it takes
+	if (madvise((char *)sfl->heap_data + start, end - start, MADV_DONTNEED))
+		return;
+
+	// Only count the pages which were not released already, since the block
+	// may have been united with released blocks
+	for (size_t page = start / HEAP_PAGE_SIZE; page < end / HEAP_PAGE_SIZE;
+		 page++) {
+		if (bitmap_test(&sfl->released, page))
+			continue;
+
+		bitmap_set(&sfl->released, page);
+		sfl->resident_memory -= HEAP_PAGE_SIZE;
+		sfl->released_memory += HEAP_PAGE_SIZE;
+	}
+}
+
+void touch_pages(sfl_t *sfl, size_t start, size_t end)
+{
+	// Count the pages no block was carved from before
+	for (size_t page = start / HEAP_PAGE_SIZE;
+		 page < (end + HEAP_PAGE_SIZE - 1) / HEAP_PAGE_SIZE; page++) {
+		if (bitmap_test(&sfl->touched, page))
+			continue;
+
+		bitmap_set(&sfl->touched, page);
+		sfl->resident_memory += HEAP_PAGE_SIZE;
 	}
+}
 
-	// Free the memory of the allocated blocks nodes
-	node_t *current = allocated_blocks.head;
-	while (current) {
-		node_t *next = current->next;
-		free(current->data);
-		free(current);
-		current = next;
+void use_pages(sfl_t *sfl, size_t block_address, size_t block_size)
+{
+	// The released pages the block covers are in memory again once it is
+	// written, and most blocks cover none, which a single search finds
+	size_t end = (block_address + block_size + HEAP_PAGE_SIZE - 1) /
+				 HEAP_PAGE_SIZE;
+	for (size_t page = bitmap_next(&sfl->released,
+								   block_address / HEAP_PAGE_SIZE);
+		 page < end; page = bitmap_next(&sfl->released, page + 1)) {
+		bitmap_clear(&sfl->released, page);
+		sfl->resident_memory += HEAP_PAGE_SIZE;
+		sfl->released_memory -= HEAP_PAGE_SIZE;
 	}
+}
 
-	// Free the memory of the segregated free lists
-	free(sfl_lists);
+size_t resident_memory(sfl_t *sfl)
+{
+	// Get a byte for every page of the heap, whose lowest bit is set if the
+	// page is in memory
+	size_t pages = (sfl->heap_size + HEAP_PAGE_SIZE - 1) / HEAP_PAGE_SIZE;
+	unsigned char *vector = malloc(pages);
+	DIE(!vector, "Malloc failed while allocating vector");
+
+	size_t resident = 0;
+	if (!mincore(sfl->heap_data, sfl->heap_size, vector)) {
+		for (size_t i = 0; i < pages; i++)
+			resident += vector[i] & 1;
+	}
 
-	// Free the memory of the heap
-	free(heap_data);
+	free(vector);
+	return resident * HEAP_PAGE_SIZE;
 }
@@ -0,0 +1,322 @@
+// fstat() and fileno() are not part of C99
+#define _DEFAULT_SOURCE
+
+#include <sys/stat.h>
+
+#include "../header.h"
+
+// The commands that can be read from the input, along with their keywords
+static const command_entry_t commands[] = {
+	{ "INIT_HEAP", COMMAND_INIT_HEAP },
+	{ "MALLOC", COMMAND_MALLOC },
+	{ "FREE", COMMAND_FREE },
+	{ "READ", COMMAND_READ },
+	{ "WRITE", COMMAND_WRITE },
+	{ "DUMP_MEMORY", COMMAND_DUMP_MEMORY },
+	{ "DESTROY_HEAP", COMMAND_DESTROY_HEAP },
+	{ "STATS", COMMAND_STATS },
+	{ "SNAPSHOT", COMMAND_SNAPSHOT },
+	{ "RESTORE", COMMAND_RESTORE },
+	{ "PROFILE", COMMAND_PROFILE },
+	{ "FRAG_REPORT", COMMAND_FRAG_REPORT },
+	{ "REALLOC", COMMAND_REALLOC },
+	{ "CALLOC", COMMAND_CALLOC },
+	{ "MEMALIGN", COMMAND_MEMALIGN },
+};
+
+void input_init(input_t *input, FILE *file)
+{
+	// Allocate the buffer, which is filled on the first read
+	input->buffer = malloc(INPUT_SIZE);
+	DIE(!input->buffer, "Malloc failed while allocating input buffer");
+
+	// Only a regular file can be read in whole blocks without waiting for
+	// input which was not written yet
+	struct stat status;
+	input->regular = !fstat(fileno(file), &status) && S_ISREG(status.st_mode);
+
+	input->file = file;
+	input->capacity = INPUT_SIZE;
+	input->size = 0;
+	input->pos = 0;
+	input->mark = NO_MARK;
+	input->binary = false;
+	input->policy = SFL_BEST_FIT;
+	input->magazines = false;
+}
+
+void input_destroy(input_t *input)
+{
+	// Free the buffer, the file belongs to the caller
+	free(input->buffer);
+	input->buffer = NULL;
+}
+
+bool input_refill(input_t *input)
+{
+	// Move the bytes from the mark to the start of the buffer, doubling the
+	// buffer if they fill it
+	size_t kept = 0;
+	if (input->mark != NO_MARK) {
+		kept = input->size - input->mark;
+		memmove(input->buffer, input->buffer + input->mark, kept);
+		input->mark = 0;
+
+		if (kept == input->capacity) {
+			input->capacity *= 2;
+			input->buffer = realloc(input->buffer, input->capacity);
+			DIE(!input->buffer, "Realloc failed while growing input buffer");
+		}
+	}
+
+	// Read the next block after them from a regular file, and only the next
+	// line otherwise, after printing the answers to the previous ones, so an
+	// interactive input gets an answer to every command
+	size_t size = 0;
+	if (input->regular) {
+		size = fread(input->buffer + kept, 1, input->capacity - kept,
+					 input->file);
+	} else {
+		fflush(stdout);
+
+		int c;
+		while (kept + size < input->capacity &&
+			   (c = getc(input->file)) != EOF) {
+			input->buffer[kept + size++] = c;
+			if (c == '\n')
+				break;
+		}
+	}
+	input->size = kept + size;
+	input->pos = kept;
+
+	return size != 0;
+}
+
+void input_mark(input_t *input)
+{
+	input->mark = input->pos;
+}
+
+const char *input_release(input_t *input)
+{
+	const char *text = input->buffer + input->mark;
+	input->mark = NO_MARK;
+
+	return text;
+}
+
+int input_peek(input_t *input)
+{
+	// Read the next block of the file once the buffer is used up
+	if (input->pos == input->size && !input_refill(input))
+		return EOF;
+
+	return (unsigned char)input->buffer[input->pos];
+}
+
+void input_skip(input_t *input)
+{
+	// Skip the whitespace before the next token
+	int c = input_peek(input);
+	while (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+		   c == '\f') {
+		input->pos += 1;
+		c = input_peek(input);
+	}
+}
+
+size_t input_word(input_t *input, char *word, size_t size)
+{
+	// Skip the whitespace before the word
+	input_skip(input);
+
+	// Copy the characters until the next whitespace, as many as fit
+	size_t length = 0;
+	for (int c = input_peek(input);
+		 c != EOF && c != ' ' && c != '\n' && c != '\t' && c != '\r' &&
+		 c != '\v' && c != '\f';
+		 c = input_peek(input)) {
+		if (length + 1 < size)
+			word[length] = c;
+
+		length += 1;
+		input->pos += 1;
+	}
+
+	// Add the null terminator
+	word[length + 1 < size ? length : size - 1] = '\0';
+
+	return length;
+}
+
+command_t input_command(input_t *input)
+{
+	// Binary traces start every command with its opcode
+	if (input->binary)
+		return binary_command(input);
+
+	char word[COMMAND_SIZE];
+
+	// Read the keyword and stop at the end of the input
+	size_t length = input_word(input, word, COMMAND_SIZE);
+	if (!length)
+		return COMMAND_EOF;
+
+	// Find the keyword in the table of commands
+	for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+		if (!strcmp(word, commands[i].name))
+			return commands[i].type;
+
+	return COMMAND_UNKNOWN;
+}
+
+const char *command_name(command_t command)
+{
+	// Find the command in the table of commands
+	for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+		if (commands[i].type == command)
+			return commands[i].name;
+
+	return "UNKNOWN";
+}
+
+size_t input_hex(input_t *input)
+{
+	// Skip the whitespace and the optional prefix of the number
+	input_skip(input);
+	if (input_peek(input) == '0') {
+		input->pos += 1;
+
+		int c = input_peek(input);
+		if (c == 'x' || c == 'X')
+			input->pos += 1;
+	}
+
+	// Add the digits to the number until the first one which is not hex
+	size_t number = 0;
+	while (true) {
+		int c = input_peek(input);
+
+		if (c >= '0' && c <= '9')
+			number = number * 16 + (c - '0');
+		else if (c >= 'a' && c <= 'f')
+			number = number * 16 + (c - 'a' + 10);
+		else if (c >= 'A' && c <= 'F')
+			number = number * 16 + (c - 'A' + 10);
+		else
+			return number;
+
+		input->pos += 1;
+	}
+}
+
+size_t input_decimal(input_t *input)
+{
+	// Skip the whitespace before the number
+	input_skip(input);
+
+	// Add the digits to the number until the first one which is not decimal
+	size_t number = 0;
+	for (int c = input_peek(input); c >= '0' && c <= '9';
+		 c = input_peek(input)) {
+		number = number * 10 + (c - '0');
+		input->pos += 1;
+	}
+
+	return number;
+}
+
+size_t input_text(input_t *input)
+{
+	// Skip characters until the opening quotation mark is found
+	int c = input_peek(input);
+	while (c != '"' && c != EOF) {
+		input->pos += 1;
+		c = input_peek(input);
+	}
+
+	// Skip the opening quotation mark
+	if (c == '"')
+		input->pos += 1;
+
+	// Keep the text in the buffer, looking for the closing quotation mark in
+	// the rest of the buffer, then in every block read after it
+	input_mark(input);
+	char *end = memchr(input->buffer + input->pos, '"',
+					   input->size - input->pos);
+	while (!end) {
+		input->pos = input->size;
+		if (!input_refill(input))
+			break;
+
+		end = memchr(input->buffer + input->pos, '"',
+					 input->size - input->pos);
+	}
+
+	// Skip the text along with the closing quotation mark, the text ending at
+	// the end of the input if there is none
+	size_t length = (end ? (size_t)(end - input->buffer) : input->size) -
+					input->mark;
+	input->pos = input->mark + length + (end != NULL);
+
+	return length;
+}
+
+void input_arguments(input_t *input, command_t command, arguments_t *arguments)
+{
+	// No command has a text, except for WRITE and the file of SNAPSHOT and
+	// RESTORE
+	arguments->text = NULL;
+	arguments->text_length = 0;
+	arguments->path[0] = '\0';
+
+	// The placement policy and the magazines are not part of the commands
+	arguments->policy = input->policy;
+	arguments->magazines = input->magazines;
+
+	// Binary traces have their own encoding of the arguments
+	if (input->binary) {
+		binary_arguments(input, command, arguments);
+		return;
+	}
+
+	switch (command) {
+	case COMMAND_INIT_HEAP:
+		arguments->address = input_hex(input);
+		arguments->lists_num = input_decimal(input);
+		arguments->bytes_per_list = input_decimal(input);
+		arguments->reconstruct_type = input_decimal(input);
+		break;
+	case COMMAND_MALLOC:
+	case COMMAND_CALLOC:
+		arguments->size = input_decimal(input);
+		break;
+	case COMMAND_MEMALIGN:
+		arguments->alignment = input_decimal(input);
+		arguments->size = input_decimal(input);
+		break;
+	case COMMAND_FREE:
+		arguments->address = input_hex(input);
+		break;
+	case COMMAND_READ:
+	case COMMAND_REALLOC:
+		arguments->address = input_hex(input);
+		arguments->size = input_decimal(input);
+		break;
+	case COMMAND_WRITE:
+		// The text stays in the buffer until the size after it is read
+		arguments->address = input_hex(input);
+		arguments->text_length = input_text(input);
+		arguments->size = input_decimal(input);
+		arguments->text = input_release(input);
+		break;
+	case COMMAND_SNAPSHOT:
+	case COMMAND_RESTORE:
+		input_word(input, arguments->path, PATH_SIZE);
+		break;
+	default:
+		// The other commands have no arguments
+		break;
+	}
+}
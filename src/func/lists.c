@@ -1,187 +1,256 @@
 #include "../header.h"
 
-size_t add_ll_node(list_t **sfl_lists, size_t index, size_t block_size,
-				   list_t *allocated_blocks, size_t *lists_num)
+size_t add_ll_node(sfl_t *sfl, size_t index, size_t block_size,
+				   tree_t *allocated_blocks)
 {
-	// Allocate memory for a new node in the allocated blocks list
-	node_t *new_ll = malloc(sizeof(node_t));
-	DIE(!new_ll, "Malloc failed while allocating node");
-
-	new_ll->data = malloc(sizeof(block_t));
-	DIE(!new_ll->data, "Malloc failed while allocating data for new_ll");
-
-	// Initialise the data of the current node
-	((block_t *)new_ll->data)->address =
-		((block_t *)(*sfl_lists)[index].head->data)->address;
-	((block_t *)new_ll->data)->size = block_size;
-	new_ll->next = NULL;
-	new_ll->prev = NULL;
-
-	// Find the position of the new node in the allocated blocks list
-	node_t *last_ll = allocated_blocks->head;
-	if (!last_ll) {
-		allocated_blocks->head = new_ll;
-	} else if (((block_t *)new_ll->data)->address <
-			   ((block_t *)last_ll->data)->address) {
-		last_ll->prev = new_ll;
-		new_ll->next = last_ll;
-
-		allocated_blocks->head = new_ll;
+	// Get the segregated free list and the uncarved blocks of the given size
+	list_t *list = find_list(sfl, index);
+	region_t *region = find_region(sfl, index);
+
+	// Take the block with the lowest address, which is either the head of
+	// the list or the first uncarved block
+	size_t block_address;
+	if (list->linked &&
+		(!region || region->next == region->end ||
+		 free_block(sfl, index, list->head)->address < region->next)) {
+		// Save the address of the first block from the segregated free list
+		block_address = free_block(sfl, index, list->head)->address;
+
+		// Remove the first block from the segregated free list
+		remove_sfl_node(sfl, index, list->head);
 	} else {
-		// Move to the appropriate position
-		while (last_ll->next && ((block_t *)last_ll->next->data)->address <
-									((block_t *)new_ll->data)->address)
-			last_ll = last_ll->next;
+		// Carve the first uncarved block
+		block_address = carve_block(sfl, index);
+	}
 
-		// Add the current node to the allocated blocks list
-		new_ll->next = last_ll->next;
-		new_ll->prev = last_ll;
+	// Add the block to the index of the allocated blocks
+	tree_insert(allocated_blocks, block_address, block_size);
 
-		if (last_ll->next)
-			last_ll->next->prev = new_ll;
+	// Return the address of the allocated block
+	return block_address;
+}
 
-		last_ll->next = new_ll;
+size_t carve_block(sfl_t *sfl, size_t index)
+{
+	// Get the segregated free list and the uncarved blocks of the given size
+	list_t *list = find_list(sfl, index);
+	region_t *region = find_region(sfl, index);
+
+	// Carve the first uncarved block
+	size_t block_address = region->next;
+	region->next += index;
+
+	// The pages past the blocks carved from the list so far are used for the
+	// first time
+	if (region->next > region->touched) {
+		touch_pages(sfl, region->touched, region->next);
+		region->touched = region->next;
 	}
 
-	// Update the number of allocated blocks
-	allocated_blocks->size += 1;
-
-	// Remove the first node from the segregated free list
-	node_t *first_sfl = (*sfl_lists)[index].head;
-	(*sfl_lists)[index].head = (*sfl_lists)[index].head->next;
-	if ((*sfl_lists)[index].head)
-		(*sfl_lists)[index].head->prev = NULL;
-
-	// Update the number of free blocks in the list
-	(*sfl_lists)[index].size -= 1;
+	// Update the number of free blocks in the list and in the heap
+	list->size -= 1;
+	count_free_blocks(sfl, index, 1, false);
 
 	// Check if the list is empty
-	if ((*sfl_lists)[index].size == 0) {
-		// Update the number of lists
-		*lists_num -= 1;
+	if (list->size == 0) {
+		// Update the number of lists and mark the size as unavailable
+		sfl->lists_num -= 1;
+		bitmap_clear(&sfl->used, index);
+	}
 
-		// Move the lists to the left
-		for (size_t j = index; j < *lists_num; j++)
-			(*sfl_lists)[j] = (*sfl_lists)[j + 1];
+	return block_address;
+}
 
-		// Reallocate memory for the segregated free lists
-		*sfl_lists = realloc(*sfl_lists, *lists_num * sizeof(list_t));
-		DIE(!sfl_lists, "Realloc failed while reallocating sfl_lists");
+void add_sfl_node(size_t block_address, size_t block_size, sfl_t *sfl)
+{
+	// Get the list which matches the remaining size
+	list_t *list = find_list(sfl, block_size);
+	region_t *region = find_region(sfl, block_size);
+
+	// If the list had no free blocks, update the number of lists and mark
+	// the size as available
+	if (!list->size) {
+		sfl->lists_num += 1;
+		bitmap_set(&sfl->used, block_size);
 	}
 
-	// Free the memory of the removed node
-	free(first_sfl->data);
-	free(first_sfl);
+	// Update the number of free blocks in the list and in the heap
+	list->size += 1;
+	count_free_blocks(sfl, block_size, 1, true);
 
-	// Return the address of the allocated block
-	return (size_t)((block_t *)new_ll->data)->address;
-}
+	// If the block is the last one carved from its initial list, it simply
+	// becomes uncarved again
+	if (region && block_address + block_size == region->next) {
+		region->next = block_address;
+		return;
+	}
 
-void add_sfl_node(size_t block_address, size_t block_size, list_t **sfl_lists,
-				  size_t *lists_num)
-{
-	// Allocate memory for a new node in the segregated free list
-	node_t *new_sfl = malloc(sizeof(node_t));
-	DIE(!new_sfl, "Malloc failed while allocating node");
+	// Take a record for the new node, inside the heap if the block is large
+	// enough to hold it
+	size_t new_sfl = block_size >= MIN_INTRUSIVE_SIZE ? block_address :
+														pool_alloc(&sfl->pool);
 
-	new_sfl->data = malloc(sizeof(block_t));
-	DIE(!new_sfl->data, "Malloc failed while allocating data for new_sfl");
+	// Writing the header brings its page back if it was released
+	if (block_size >= MIN_INTRUSIVE_SIZE)
+		use_pages(sfl, block_address,
+				  ALIGN_UP(block_address) + sizeof(block_t) - block_address);
 
 	// Set the data of the current node
-	((block_t *)new_sfl->data)->address = (void *)(block_address);
-	((block_t *)new_sfl->data)->size = block_size;
-
-	// Find the list which matches the remaining size
-	for (size_t j = 0; j < *lists_num; j++) {
-		if (((block_t *)(*sfl_lists)[j].head->data)->size != block_size)
-			continue;
-
-		// Find the position of the new node in the segregated free list
-		node_t *last_sfl = (*sfl_lists)[j].head;
-
-		if (((block_t *)new_sfl->data)->address <
-			((block_t *)last_sfl->data)->address) {
-			new_sfl->next = (*sfl_lists)[j].head;
-			new_sfl->prev = NULL;
-			(*sfl_lists)[j].head->prev = new_sfl;
-			(*sfl_lists)[j].head = new_sfl;
-		} else {
-			// Move to the appropriate position
-			while (last_sfl->next &&
-				   ((block_t *)last_sfl->next->data)->address <
-					   ((block_t *)new_sfl->data)->address)
-				last_sfl = last_sfl->next;
-
-			// Add the current node to the segregated free list
-			new_sfl->next = last_sfl->next;
-			new_sfl->prev = last_sfl;
-			last_sfl->next = new_sfl;
-		}
+	block_t *block = free_block(sfl, block_size, new_sfl);
+	block->address = block_address;
+	block->size = block_size;
+
+	// Let the pool find the record of a small block by its address
+	if (block_size < MIN_INTRUSIVE_SIZE)
+		pool_insert(&sfl->pool, new_sfl);
 
-		// Update the number of free blocks in the list
-		(*sfl_lists)[j].size += 1;
+	// If the list has no other node, the new node becomes its only node
+	list->linked += 1;
+	if (list->linked == 1) {
+		list->head = new_sfl;
+		block->next = NO_BLOCK;
+		block->prev = NO_BLOCK;
 
-		// Return if the list was found and updated
 		return;
 	}
 
-	// If there is no list with the remaining size, add a new list
+	// Find the position of the new node in the segregated free list
+	size_t last_sfl = list->head;
+	block_t *last = free_block(sfl, block_size, last_sfl);
 
-	// Update the number of lists
-	*lists_num += 1;
-	*sfl_lists = realloc(*sfl_lists, *lists_num * sizeof(list_t));
-	DIE(!*sfl_lists, "Realloc failed while reallocating sfl_lists");
+	if (block_address < last->address) {
+		block->next = list->head;
+		block->prev = NO_BLOCK;
+		last->prev = new_sfl;
+		list->head = new_sfl;
+	} else {
+		// Move to the appropriate position
+		while (last->next != NO_BLOCK &&
+			   free_block(sfl, block_size, last->next)->address <
+				   block_address) {
+			last_sfl = last->next;
+			last = free_block(sfl, block_size, last_sfl);
+		}
 
-	// Find the index of the new list
-	for (size_t j = 0; j < *lists_num; j++) {
-		if (j == *lists_num - 1 ||
-			((block_t *)(*sfl_lists)[j].head->data)->size > block_size) {
-			// Move the lists to the right
-			for (size_t k = *lists_num - 1; k > j; k--)
-				(*sfl_lists)[k] = (*sfl_lists)[k - 1];
+		// Add the current node to the segregated free list
+		block->next = last->next;
+		block->prev = last_sfl;
 
-			// Add and initialise the new list
-			(*sfl_lists)[j].size = 1;
-			(*sfl_lists)[j].head = new_sfl;
-			new_sfl->next = NULL;
-			new_sfl->prev = NULL;
+		if (last->next != NO_BLOCK)
+			free_block(sfl, block_size, last->next)->prev = new_sfl;
 
-			return;
-		}
+		last->next = new_sfl;
 	}
 }
 
-node_t *remove_ll_node(list_t *allocated_blocks, size_t block_address,
-					   void *heap_data, size_t start_address)
+void remove_sfl_node(sfl_t *sfl, size_t index, size_t node)
+{
+	// Get the list and the block to remove
+	list_t *list = find_list(sfl, index);
+	block_t *block = free_block(sfl, index, node);
+
+	// Remove the current node from the segregated free list
+	if (block->prev != NO_BLOCK)
+		free_block(sfl, index, block->prev)->next = block->next;
+	else
+		list->head = block->next;
+
+	// Reconnect the segregated free list
+	if (block->next != NO_BLOCK)
+		free_block(sfl, index, block->next)->prev = block->prev;
+
+	// Update the number of free blocks in the list and in the heap
+	list->size -= 1;
+	list->linked -= 1;
+	count_free_blocks(sfl, index, 1, false);
+
+	// Check if the list is empty, its entry being kept for the next blocks
+	// of the same size
+	if (list->size == 0) {
+		// Update the number of lists and mark the size as unavailable
+		sfl->lists_num -= 1;
+		bitmap_clear(&sfl->used, index);
+	}
+
+	// Give the record back to the pool if the block had one
+	if (index < MIN_INTRUSIVE_SIZE) {
+		pool_erase(&sfl->pool, node);
+		pool_free(&sfl->pool, node);
+	}
+}
+
+void remove_free_block(sfl_t *sfl, size_t block_address, size_t block_size)
+{
+	// Large blocks are linked by their address, small ones by their record
+	size_t node = block_size >= MIN_INTRUSIVE_SIZE ?
+					  block_address :
+					  pool_find(&sfl->pool, block_address);
+
+	// Remove the block from its segregated free list
+	remove_sfl_node(sfl, block_size, node);
+}
+
+size_t remove_ll_node(tree_t *allocated_blocks, size_t block_address,
+					  size_t start_address)
 {
 	// Find the block with the given address
-	for (node_t *current_ll = allocated_blocks->head; current_ll;
-		 current_ll = current_ll->next) {
-		if (block_address != (size_t)((block_t *)current_ll->data)->address -
-								 (size_t)(char *)heap_data + start_address)
-			continue;
-
-		// Remove the current node from the allocated blocks list
-		if (current_ll->prev)
-			current_ll->prev->next = current_ll->next;
-		else
-			allocated_blocks->head = current_ll->next;
-
-		// Reconnect the allocated blocks list
-		if (current_ll->next)
-			current_ll->next->prev = current_ll->prev;
-
-		// Update the number of allocated blocks
-		allocated_blocks->size -= 1;
-
-		// Check if the list is empty
-		if (((block_t *)current_ll->data)->size == 0)
-			allocated_blocks->head = NULL;
-
-		// Return the current node
-		return current_ll;
+	size_t current_ll =
+		tree_find(allocated_blocks, block_address - start_address);
+
+	// Return NO_BLOCK if the block was not found
+	if (current_ll == NO_BLOCK)
+		return NO_BLOCK;
+
+	// Save the size of the block
+	size_t block_size = allocated_blocks->nodes[current_ll].size;
+
+	// Remove the current node from the allocated blocks
+	tree_remove(allocated_blocks, current_ll);
+
+	// Return the size of the removed block
+	return block_size;
+}
+
+void count_free_blocks(sfl_t *sfl, size_t block_size, size_t count,
+					   bool added)
+{
+	// Find the size class of the blocks, by their highest set bit
+	size_t size_class = 63 - __builtin_clzll(block_size);
+
+	// Only the blocks smaller than the ones of the first list are wasted
+	size_t wasted = block_size < WASTED_SIZE ? count * block_size : 0;
+
+	if (added) {
+		sfl->free_memory += count * block_size;
+		sfl->free_blocks += count;
+		sfl->wasted_memory += wasted;
+		sfl->class_blocks[size_class] += count;
+		sfl->class_memory[size_class] += count * block_size;
+	} else {
+		sfl->free_memory -= count * block_size;
+		sfl->free_blocks -= count;
+		sfl->wasted_memory -= wasted;
+		sfl->class_blocks[size_class] -= count;
+		sfl->class_memory[size_class] -= count * block_size;
 	}
+}
 
-	// Return NULL if the block was not found
-	return NULL;
+void count_allocated_block(sfl_heap_t *heap, size_t block_address,
+						   size_t block_size, bool added)
+{
+	// Every block stays inside the initial list it was carved from
+	region_t *region = &heap->sfl.regions[block_address / heap->bytes_per_list];
+
+	if (added) {
+		// The block may cover pages released while it was free
+		use_pages(&heap->sfl, block_address, block_size);
+
+		heap->allocated_memory += block_size;
+		region->allocated_memory += block_size;
+		region->allocated_blocks += 1;
+	} else {
+		heap->allocated_memory -= block_size;
+		region->allocated_memory -= block_size;
+		region->allocated_blocks -= 1;
+	}
 }
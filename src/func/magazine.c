@@ -0,0 +1,115 @@
+#include "../header.h"
+
+bool magazine_indexed(sfl_heap_t *heap)
+{
+	// Only the blocks united with all their free neighbours need to know
+	// which of them are kept, the buddy system checks its own bitmaps
+	return heap->reconstruct_type &&
+		   heap->reconstruct_type != RECONSTRUCT_BUDDY;
+}
+
+bool magazine_push(sfl_heap_t *heap, size_t block_address, size_t block_size)
+{
+	// Only the small sizes have a magazine, which keeps a few blocks
+	if (!heap->magazines || block_size > MAGAZINE_MAX_SIZE)
+		return false;
+
+	magazine_t *magazine = &heap->magazines[block_size];
+	if (magazine->count == MAGAZINE_DEPTH)
+		return false;
+
+	// Keep the block on top of the magazine, where it is taken first
+	magazine->blocks[magazine->count++] = block_address;
+	heap->magazine_blocks += 1;
+
+	// The heaps which unite free blocks also index it, so no free block is
+	// united across it
+	if (magazine_indexed(heap))
+		tree_insert(&heap->cached_blocks, block_address, block_size);
+
+	// The block is still free memory, just not linked in its list
+	count_free_blocks(&heap->sfl, block_size, 1, true);
+
+	return true;
+}
+
+size_t magazine_pop(sfl_heap_t *heap, size_t block_size)
+{
+	// Only the small sizes have a magazine
+	if (!heap->magazines || block_size > MAGAZINE_MAX_SIZE)
+		return NO_BLOCK;
+
+	magazine_t *magazine = &heap->magazines[block_size];
+	if (!magazine->count)
+		return NO_BLOCK;
+
+	// Take the block which was freed last
+	size_t block_address = magazine->blocks[--magazine->count];
+	heap->magazine_blocks -= 1;
+
+	if (magazine_indexed(heap))
+		tree_remove(&heap->cached_blocks,
+					tree_find(&heap->cached_blocks, block_address));
+
+	count_free_blocks(&heap->sfl, block_size, 1, false);
+
+	return block_address;
+}
+
+void magazine_flush(sfl_heap_t *heap)
+{
+	// Nothing to do if every magazine is empty
+	if (!heap->magazine_blocks)
+		return;
+
+	// Give every kept block back to the segregated free lists, like a freed
+	// block, so it is united with its free neighbours
+	for (size_t size = 1; size <= MAGAZINE_MAX_SIZE; size++) {
+		while (heap->magazines[size].count) {
+			size_t block_address = magazine_pop(heap, size);
+			reclaim_block(heap, block_address, size);
+		}
+	}
+}
+
+size_t magazine_next(sfl_heap_t *heap, size_t block_size)
+{
+	// Find the first size from the given one whose magazine has blocks
+	if (heap->magazine_blocks) {
+		for (size_t size = block_size; size <= MAGAZINE_MAX_SIZE; size++)
+			if (heap->magazines[size].count)
+				return size;
+	}
+
+	return NO_BLOCK;
+}
+
+size_t magazine_last(sfl_heap_t *heap)
+{
+	// Find the largest size whose magazine has blocks
+	if (heap->magazine_blocks) {
+		for (size_t size = MAGAZINE_MAX_SIZE; size; size--)
+			if (heap->magazines[size].count)
+				return size;
+	}
+
+	return 0;
+}
+
+size_t magazine_sorted(sfl_heap_t *heap, size_t block_size, size_t *blocks)
+{
+	if (block_size > MAGAZINE_MAX_SIZE || !heap->magazine_blocks)
+		return 0;
+
+	// Sort the few blocks of the magazine by their address
+	magazine_t *magazine = &heap->magazines[block_size];
+	for (size_t i = 0; i < magazine->count; i++) {
+		size_t j = i;
+		for (; j && blocks[j - 1] > magazine->blocks[i]; j--)
+			blocks[j] = blocks[j - 1];
+
+		blocks[j] = magazine->blocks[i];
+	}
+
+	return magazine->count;
+}
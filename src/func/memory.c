@@ -1,172 +1,508 @@
 #include "../header.h"
 
-void malloc_f(list_t **sfl_lists, size_t *lists_num, list_t *allocated_blocks,
-			  size_t *fragmentations, size_t *malloc_calls)
+// The names of the placement policies, in the order of sfl_policy_t
+static const char *policy_names[] = {
+	"best-fit",
+	"first-fit",
+	"exact-fit-first",
+	"next-fit",
+};
+
+size_t find_fit(sfl_heap_t *heap, size_t block_size)
 {
-	// Declare the variable for the block size
-	size_t block_size;
+	sfl_t *sfl = &heap->sfl;
+
+	switch (heap->policy) {
+	case SFL_FIRST_FIT: {
+		// Every list starts with its lowest address, either its head or its
+		// first uncarved block, so only the first block of every list which
+		// fits is compared
+		size_t best = sfl->max_size + 1, best_address = NO_BLOCK;
+		PROFILE(size_t steps = 0;)
+		for (size_t i = bitmap_next(&sfl->used, block_size); i <= sfl->max_size;
+			 i = bitmap_next(&sfl->used, i + 1)) {
+			PROFILE(steps += 1;)
+			list_t *list = find_list(sfl, i);
+			region_t *region = find_region(sfl, i);
+
+			size_t address = NO_BLOCK;
+			if (list->linked)
+				address = free_block(sfl, i, list->head)->address;
+			if (region && region->next < region->end && region->next < address)
+				address = region->next;
+
+			if (address < best_address) {
+				best = i;
+				best_address = address;
+			}
+		}
+
+		PROFILE(histogram_add(&heap->profile.walks[WALK_FIT], steps);)
+		return best;
+	}
+	case SFL_EXACT_FIT_FIRST: {
+		// Take a block of the same size, so nothing is split, or else the
+		// largest one, so the rest is as large as possible
+		if (block_size <= sfl->max_size && bitmap_test(&sfl->used, block_size))
+			return block_size;
+
+		size_t largest = bitmap_last(&sfl->used);
+		return largest < block_size ? sfl->max_size + 1 : largest;
+	}
+	case SFL_NEXT_FIT: {
+		// Continue from the list the previous block was taken from, and start
+		// again from the smallest one that fits when there is no list after it
+		size_t start = heap->next_size > block_size ? heap->next_size :
+													  block_size;
+		size_t i = bitmap_next(&sfl->used, start);
+		if (i > sfl->max_size)
+			i = bitmap_next(&sfl->used, block_size);
+
+		if (i <= sfl->max_size)
+			heap->next_size = i;
+
+		return i;
+	}
+	default:
+		// Take the smallest block which fits, from the first non-empty list
+		// whose size is at least the requested one
+		return bitmap_next(&sfl->used, block_size);
+	}
+}
 
-	// Read the size of the block to be allocated
-	scanf("%lu", &block_size);
+size_t align_offset(sfl_heap_t *heap, size_t block_address, size_t alignment)
+{
+	// Alignments are of the real addresses, not of the offsets
+	size_t address = heap->start_address + block_address;
+	return ((address + alignment - 1) & ~(alignment - 1)) - address;
+}
 
-	// Find the list with the smallest element size that can store the
-	// requested size
-	for (size_t i = 0; i < *lists_num; i++) {
-		// If the current list is too small or empty, continue
-		if (((block_t *)(*sfl_lists)[i].head->data)->size < block_size ||
-			!(*sfl_lists)[i].head)
-			continue;
+size_t find_aligned(sfl_heap_t *heap, size_t index, size_t alignment,
+					size_t block_size, size_t step)
+{
+	sfl_t *sfl = &heap->sfl;
+	list_t *list = find_list(sfl, index);
+	region_t *region = find_region(sfl, index);
+
+	// Only the first uncarved block can be taken, so it is the only one
+	// checked
+	size_t best = NO_BLOCK;
+	if (region && region->next < region->end) {
+		size_t skipped = align_offset(heap, region->next, alignment);
+		if (skipped % step == 0 && skipped + block_size <= index)
+			best = region->next;
+	}
 
-		// Count valid malloc calls
-		*malloc_calls += 1;
+	// The nodes of the list are sorted, so the first one which fits is the
+	// one with the lowest address; every block fits once the list is larger
+	// than the block by the alignment, so only the smaller lists are walked
+	for (size_t current = list->linked ? list->head : NO_BLOCK;
+		 current != NO_BLOCK;) {
+		block_t *block = free_block(sfl, index, current);
+		if (block->address > best)
+			break;
 
-		// Calculate the remaining size
-		size_t remaining_size =
-			((block_t *)(*sfl_lists)[i].head->data)->size - block_size;
+		size_t skipped = align_offset(heap, block->address, alignment);
+		if (skipped % step == 0 && skipped + block_size <= index)
+			return block->address;
 
-		// Add a new node to the allocated blocks list and save the address
-		size_t block_address =
-			add_ll_node(sfl_lists, i, block_size, allocated_blocks, lists_num);
+		current = block->next;
+	}
 
-		// Add the remaining memory to the next list
-		if (remaining_size) {
-			// Count fragmentations of the memory
-			*fragmentations += 1;
+	return best;
+}
 
-			add_sfl_node(block_address + block_size, remaining_size, sfl_lists,
-						 lists_num);
-		}
+size_t take_free_block(sfl_t *sfl, size_t index, size_t block_address)
+{
+	// Carve the block if it is the first uncarved one, or remove it from its
+	// list otherwise; a linked block may start where the carved ones end
+	region_t *region = find_region(sfl, index);
+	if (region && region->next < region->end && block_address == region->next)
+		return carve_block(sfl, index);
+
+	remove_free_block(sfl, block_address, index);
+	return block_address;
+}
 
-		// Return if the block was successfully allocated
-		return;
+sfl_policy_t find_policy(const char *name)
+{
+	// Compare the name with the name of every policy
+	for (size_t i = 0; i < SFL_POLICIES; i++) {
+		if (!strcmp(name, policy_names[i]))
+			return i;
 	}
 
-	// If there is no list with enough memory, print an error message
-	printf("Out of memory\n");
-}
-
-bool defragmented(size_t *lists_num, list_t **sfl_lists, size_t *block_address,
-				  size_t *block_size, void *heap_data, size_t start_address,
-				  size_t bytes_per_list)
-{
-	// Search for compatible blocks in the segregated free lists
-	for (size_t i = 0; i < *lists_num; i++) {
-		for (node_t *current = (*sfl_lists)[i].head; current;
-			 current = current->next) {
-			// Check if the current node has the same parent block as the
-			// freed block
-			if (!same_parent(*block_address - start_address,
-							 (size_t)((block_t *)(size_t)current->data)
-							 ->address,
-							 heap_data, bytes_per_list))
-				continue;
-
-			// Check if the current node is adjacent to the freed block
-			if ((size_t)((block_t *)(size_t)current->data)->address -
-						(size_t)heap_data + start_address +
-						((block_t *)(*sfl_lists)[i].head->data)->size !=
-					*block_address &&
-				(size_t)((block_t *)(size_t)current->data)->address -
-						(size_t)heap_data + start_address - *block_size !=
-					*block_address)
-				continue;
-
-			// If the current node is adjacent to the freed block, merge them
-			if ((size_t)((block_t *)(size_t)current->data)->address -
-					(size_t)heap_data + start_address +
-					((block_t *)(*sfl_lists)[i].head->data)->size ==
-				*block_address)
-				*block_address -= ((block_t *)(*sfl_lists)[i].head->data)->size;
-
-			*block_size += ((block_t *)(*sfl_lists)[i].head->data)->size;
-
-			// Remove the current node from the segregated free list
-			if (((*sfl_lists)[i].head != current) && current->prev)
-				current->prev->next = current->next;
-			else
-				(*sfl_lists)[i].head = current->next;
-
-			// Reconnect the segregated free list
-			if (current->next)
-				current->next->prev = current->prev;
-
-			// Update the number of free blocks in the list
-			(*sfl_lists)[i].size -= 1;
-
-			// Check if the list is empty
-			if ((*sfl_lists)[i].size == 0) {
-				// Update the number of lists
-				*lists_num -= 1;
-
-				// Move the lists to the left
-				for (size_t j = i; j < *lists_num; j++)
-					(*sfl_lists)[j] = (*sfl_lists)[j + 1];
-
-				// Reallocate memory for the segregated free lists
-				*sfl_lists = realloc(*sfl_lists, *lists_num * sizeof(list_t));
-				DIE(!sfl_lists, "Realloc failed while reallocating sfl_lists");
-			}
+	return SFL_POLICIES;
+}
 
-			// Free the memory of the removed node
-			free(current->data);
-			free(current);
+const char *policy_name(sfl_policy_t policy)
+{
+	return policy < SFL_POLICIES ? policy_names[policy] : "unknown";
+}
 
-			// Return true if the blocks were merged
-			return true;
-		}
+size_t malloc_f(sfl_heap_t *heap, size_t block_size)
+{
+	sfl_t *sfl = &heap->sfl;
+
+	// Do nothing for malloc(0), an empty block would share its address with
+	// the block after it
+	if (!block_size)
+		return NO_BLOCK;
+
+	// The buddy system rounds and splits the blocks its own way
+	if (heap->reconstruct_type == RECONSTRUCT_BUDDY)
+		return buddy_malloc(heap, block_size);
+
+	// Reuse a block of the same size which was freed recently, if there is one
+	size_t block_address = magazine_malloc(heap, block_size);
+	if (block_address != NO_BLOCK)
+		return block_address;
+
+	// Find the list whose block is taken, by the placement policy of the heap,
+	// giving the blocks of the magazines back to the lists if none fits
+	size_t i = find_fit(heap, block_size);
+	if (i > sfl->max_size && heap->magazine_blocks) {
+		magazine_flush(heap);
+		i = find_fit(heap, block_size);
+	}
+
+	// If there is no list with enough memory, nothing is allocated
+	if (i > sfl->max_size)
+		return NO_BLOCK;
+
+	// Count valid malloc calls
+	heap->malloc_calls += 1;
+
+	// Calculate the remaining size
+	size_t remaining_size = i - block_size;
+
+	// Add a new node to the allocated blocks and save the address
+	block_address = add_ll_node(sfl, i, block_size, &heap->allocated_blocks);
+
+	// Count the allocated memory, in the heap and in its initial list
+	count_allocated_block(heap, block_address, block_size, true);
+
+	// Add the remaining memory to the next list
+	if (remaining_size) {
+		// Count fragmentations of the memory
+		heap->fragmentations += 1;
+
+		add_sfl_node(block_address + block_size, remaining_size, sfl);
 	}
 
-	// Return false if the blocks were not merged
-	return false;
+	// Return the offset of the allocated block
+	return block_address;
+}
+
+void find_gap(tree_t *tree, size_t block_address, size_t *left, size_t *right)
+{
+	// Find the blocks of the index right before and after the given one
+	tree_node_t *nodes = tree->nodes;
+	size_t prev = tree_floor(tree, block_address);
+	size_t next = prev == NO_BLOCK ? tree->head : nodes[prev].next;
+
+	// Move the ends of the gap to them if they are inside it
+	if (prev != NO_BLOCK && nodes[prev].address + nodes[prev].size > *left)
+		*left = nodes[prev].address + nodes[prev].size;
+
+	if (next != NO_BLOCK && nodes[next].address < *right)
+		*right = nodes[next].address;
 }
 
-void free_f(list_t **sfl_lists, size_t *lists_num, list_t *allocated_blocks,
-			size_t *free_calls, size_t reconstruct_type, void *heap_data,
-			size_t start_address, size_t bytes_per_list)
+void coalesce(sfl_t *sfl, tree_t *allocated_blocks, tree_t *cached_blocks,
+			  size_t *block_address, size_t *block_size, size_t bytes_per_list)
 {
-	// Declare the variable for the block address
-	size_t block_address;
+	// Blocks are only united inside their parent block
+	size_t left, right;
+	find_parent(*block_address, bytes_per_list, &left, &right);
+
+	// Every byte of the parent block between the freed block and the allocated
+	// or cached ones is free, and since free blocks are always united, it is
+	// held by a single block on each side
+	find_gap(allocated_blocks, *block_address, &left, &right);
+	find_gap(cached_blocks, *block_address, &left, &right);
+
+	// Unite the block with the free block to its left
+	PROFILE(size_t merges = 0;)
+	if (left < *block_address) {
+		remove_free_block(sfl, left, *block_address - left);
+		PROFILE(merges += 1;)
+
+		*block_size += *block_address - left;
+		*block_address = left;
+	}
 
-	// Read the address of the block to be freed
-	scanf("%lx", &block_address);
+	// Unite the block with the free block to its right
+	if (*block_address + *block_size < right) {
+		remove_free_block(sfl, *block_address + *block_size,
+						  right - *block_address - *block_size);
+		PROFILE(merges += 1;)
 
-	// size_t original_address = block_address;
+		*block_size = right - *block_address;
+	}
+
+	PROFILE(histogram_add(&allocated_blocks->profile->merges, merges);)
+}
 
+bool free_f(sfl_heap_t *heap, size_t block_address)
+{
 	if (block_address == 0) {
 		// Count free calls
-		*free_calls += 1;
+		heap->free_calls += 1;
 
 		// Do nothing for free(NULL)
-		return;
+		return true;
 	}
 
-	// Find the block in the allocated blocks list
-	node_t *current_ll = remove_ll_node(allocated_blocks, block_address,
-										heap_data, start_address);
-	if (!current_ll) {
-		// Print an error message if the block was not found
-		printf("Invalid free\n");
+	// Find the block in the allocated blocks and save its size, so it can be
+	// increased if the block is merged
+	size_t block_size = remove_ll_node(&heap->allocated_blocks, block_address,
+									   heap->start_address);
+
+	// Nothing is freed if the block was not found
+	if (block_size == NO_BLOCK)
+		return false;
+
+	// Work with the offset of the block from the start of the heap
+	block_address -= heap->start_address;
+
+	// Count free calls and the allocated memory
+	heap->free_calls += 1;
+	count_allocated_block(heap, block_address, block_size, false);
+
+	// Keep the block for the next malloc of the same size if its magazine has
+	// room, or give it back to the lists otherwise
+	if (!magazine_push(heap, block_address, block_size))
+		reclaim_block(heap, block_address, block_size);
+
+	return true;
+}
+
+void reclaim_block(sfl_heap_t *heap, size_t block_address, size_t block_size)
+{
+	// The buddy system unites the block with its buddies only
+	if (heap->reconstruct_type == RECONSTRUCT_BUDDY) {
+		buddy_free(heap, block_address, block_size);
 		return;
 	}
 
-	// Count free calls
-	*free_calls += 1;
+	// Unite the block with its free neighbours
+	if (heap->reconstruct_type)
+		coalesce(&heap->sfl, &heap->allocated_blocks, &heap->cached_blocks,
+				 &block_address, &block_size, heap->bytes_per_list);
+
+	// Free the block and release the pages it covers
+	add_sfl_node(block_address, block_size, &heap->sfl);
+	release_pages(&heap->sfl, block_address, block_size);
+}
+
+size_t magazine_malloc(sfl_heap_t *heap, size_t block_size)
+{
+	// Take the block which was freed last from the magazine of the size
+	size_t block_address = magazine_pop(heap, block_size);
+	if (block_address == NO_BLOCK)
+		return NO_BLOCK;
+
+	// The block has the requested size, so nothing is split
+	heap->malloc_calls += 1;
+	tree_insert(&heap->allocated_blocks, block_address, block_size);
+	count_allocated_block(heap, block_address, block_size, true);
+
+	return block_address;
+}
+
+size_t memalign_f(sfl_heap_t *heap, size_t alignment, size_t block_size)
+{
+	sfl_t *sfl = &heap->sfl;
+
+	// Do nothing for an empty block or an alignment which is not a power of
+	// two
+	if (!block_size || !alignment || (alignment & (alignment - 1)))
+		return NO_BLOCK;
+
+	// The buddy system can only split its blocks in halves
+	if (heap->reconstruct_type == RECONSTRUCT_BUDDY)
+		return buddy_memalign(heap, alignment, block_size);
+
+	// Find the smallest free block which holds an aligned range of the size,
+	// giving the blocks of the magazines back to the lists if none does
+	size_t i, block_address = NO_BLOCK;
+	for (size_t tries = 0; tries < 2 && block_address == NO_BLOCK; tries++) {
+		if (tries && !heap->magazine_blocks)
+			break;
+		if (tries)
+			magazine_flush(heap);
+
+		for (i = bitmap_next(&sfl->used, block_size); i <= sfl->max_size;
+			 i = bitmap_next(&sfl->used, i + 1)) {
+			block_address = find_aligned(heap, i, alignment, block_size, 1);
+			if (block_address != NO_BLOCK)
+				break;
+		}
+	}
+
+	// If there is no such block, nothing is allocated
+	if (block_address == NO_BLOCK)
+		return NO_BLOCK;
+
+	// Count valid malloc calls
+	heap->malloc_calls += 1;
+
+	// Take the block, giving the bytes before the aligned range back to the
+	// lists as a fragmentation
+	take_free_block(sfl, i, block_address);
+	size_t skipped = align_offset(heap, block_address, alignment);
+	if (skipped) {
+		heap->fragmentations += 1;
+		add_sfl_node(block_address, skipped, sfl);
+		block_address += skipped;
+	}
+
+	// Add the aligned range to the allocated blocks and count it
+	tree_insert(&heap->allocated_blocks, block_address, block_size);
+	count_allocated_block(heap, block_address, block_size, true);
 
-	// Save the block size so it can be increased if the block is merged
-	size_t block_size = ((block_t *)current_ll->data)->size;
+	// Give the bytes after it back to the lists as another fragmentation
+	size_t remaining_size = i - skipped - block_size;
+	if (remaining_size) {
+		heap->fragmentations += 1;
+		add_sfl_node(block_address + block_size, remaining_size, sfl);
+	}
+
+	return block_address;
+}
 
-	bool loop = true;
-	if (reconstruct_type)
-		while (loop)
-			loop = defragmented(lists_num, sfl_lists, &block_address,
-								&block_size, heap_data, start_address,
-								bytes_per_list);
+size_t calloc_f(sfl_heap_t *heap, size_t block_size)
+{
+	size_t block_address = malloc_f(heap, block_size);
+
+	// Zero the whole block at once, it may hold the bytes of a freed block
+	if (block_address != NO_BLOCK)
+		memset((char *)heap->sfl.heap_data + block_address, 0, block_size);
 
-	// Free the block
-	add_sfl_node(block_address + (size_t)heap_data - start_address, block_size,
-				 sfl_lists, lists_num);
+	return block_address;
+}
+
+bool resize_block(sfl_heap_t *heap, size_t node, size_t new_size)
+{
+	// The buddy system keeps every block a power of two
+	if (heap->reconstruct_type == RECONSTRUCT_BUDDY)
+		return buddy_resize(heap, node, new_size);
+
+	sfl_t *sfl = &heap->sfl;
+	tree_node_t *block = &heap->allocated_blocks.nodes[node];
+	size_t block_address = block->address;
+	size_t block_size = block->size;
+
+	if (new_size > block_size) {
+		// Only the heaps which unite free blocks know that all the bytes
+		// after the block, up to the next allocated or kept one, are a single
+		// free block
+		if (!heap->reconstruct_type)
+			return false;
+
+		size_t left, right;
+		find_parent(block_address, heap->bytes_per_list, &left, &right);
+		find_gap(&heap->allocated_blocks, block_address, &left, &right);
+		find_gap(&heap->cached_blocks, block_address, &left, &right);
+
+		// Check that the block and its free neighbour are large enough
+		size_t end = block_address + block_size;
+		if (right - block_address < new_size)
+			return false;
+
+		// Take the free neighbour, giving back what the block does not need
+		remove_free_block(sfl, end, right - end);
+		if (right - block_address > new_size) {
+			heap->fragmentations += 1;
+			add_sfl_node(block_address + new_size,
+						 right - block_address - new_size, sfl);
+		}
+	}
+
+	// Count the allocated memory with the new size of the block
+	count_allocated_block(heap, block_address, block_size, false);
+	block->size = new_size;
+	count_allocated_block(heap, block_address, new_size, true);
+
+	// Split the end of a shrunk block off, freeing it like a block of its own
+	if (new_size < block_size) {
+		heap->fragmentations += 1;
+		reclaim_block(heap, block_address + new_size, block_size - new_size);
+	}
+
+	return true;
+}
+
+bool realloc_f(sfl_heap_t *heap, size_t block_address, size_t block_size,
+			   size_t *new_address)
+{
+	// A missing block is simply allocated
+	if (!block_address) {
+		*new_address = malloc_f(heap, block_size);
+		return true;
+	}
+
+	// Find the block in the allocated blocks
+	tree_t *allocated_blocks = &heap->allocated_blocks;
+	size_t node = tree_find(allocated_blocks,
+							block_address - heap->start_address);
+	if (node == NO_BLOCK)
+		return false;
+
+	// A block resized to nothing is freed
+	if (!block_size) {
+		free_f(heap, block_address);
+		*new_address = NO_BLOCK;
+		return true;
+	}
+
+	// Keep the block where it is if it can be shrunk or grown in place
+	size_t old_address = allocated_blocks->nodes[node].address;
+	size_t old_size = allocated_blocks->nodes[node].size;
+	if (resize_block(heap, node, block_size)) {
+		*new_address = old_address;
+		return true;
+	}
+
+	// Move the block otherwise, keeping it if there is not enough memory
+	*new_address = malloc_f(heap, block_size);
+	if (*new_address == NO_BLOCK)
+		return true;
+
+	// Copy the bytes which fit in the new block inside the heap data
+	char *heap_data = heap->sfl.heap_data;
+	memcpy(heap_data + *new_address, heap_data + old_address,
+		   old_size < block_size ? old_size : block_size);
+	free_f(heap, block_address);
+
+	return true;
+}
+
+bool find_span(tree_t *allocated_blocks, size_t block_address, size_t size)
+{
+	// Get the nodes of the allocated blocks
+	tree_node_t *blocks = allocated_blocks->nodes;
+
+	// Find the allocated block which holds the first byte of the range
+	size_t current = tree_floor(allocated_blocks, block_address);
+	if (current == NO_BLOCK ||
+		blocks[current].address + blocks[current].size <= block_address)
+		return false;
+
+	// Continue with the blocks which follow it without a gap, until the
+	// whole range is covered
+	size_t end = blocks[current].address + blocks[current].size;
+	PROFILE(size_t steps = 1;)
+	while (end - block_address < size) {
+		current = blocks[current].next;
+		if (current == NO_BLOCK || blocks[current].address != end)
+			return false;
+
+		end += blocks[current].size;
+		PROFILE(steps += 1;)
+	}
 
-	// Free the memory of the removed node
-	free(current_ll->data);
-	free(current_ll);
+	PROFILE(histogram_add(&allocated_blocks->profile->walks[WALK_SPAN], steps);)
+	return true;
 }
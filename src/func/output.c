@@ -0,0 +1,83 @@
+#include "../header.h"
+
+// The hex digit of every value of 4 bits
+static const char hex_digits[] = "0123456789abcdef";
+
+// The two decimal digits of every value below 100
+static const char decimal_digits[] = "00010203040506070809"
+									 "10111213141516171819"
+									 "20212223242526272829"
+									 "30313233343536373839"
+									 "40414243444546474849"
+									 "50515253545556575859"
+									 "60616263646566676869"
+									 "70717273747576777879"
+									 "80818283848586878889"
+									 "90919293949596979899";
+
+void output_flush(output_t *output)
+{
+	// Write the whole buffer at once, after whatever was printed before it
+	if (output->size)
+		fwrite(output->buffer, 1, output->size, stdout);
+	output->size = 0;
+}
+
+void output_text(output_t *output, const char *text, size_t length)
+{
+	// Make room for the text, writing a text larger than the buffer directly
+	if (output->size + length > OUTPUT_SIZE) {
+		output_flush(output);
+		if (length > OUTPUT_SIZE) {
+			fwrite(text, 1, length, stdout);
+			return;
+		}
+	}
+
+	memcpy(output->buffer + output->size, text, length);
+	output->size += length;
+}
+
+void output_string(output_t *output, const char *text)
+{
+	output_text(output, text, strlen(text));
+}
+
+void output_hex(output_t *output, size_t value)
+{
+	// Write the digits backwards, from the lowest 4 bits
+	char digits[NUMBER_SIZE];
+	size_t pos = NUMBER_SIZE;
+	do {
+		digits[--pos] = hex_digits[value & 15];
+		value >>= 4;
+	} while (value);
+
+	digits[--pos] = 'x';
+	digits[--pos] = '0';
+
+	output_text(output, digits + pos, NUMBER_SIZE - pos);
+}
+
+void output_decimal(output_t *output, size_t value)
+{
+	// Write the digits backwards, two of them at a time
+	char digits[NUMBER_SIZE];
+	size_t pos = NUMBER_SIZE;
+	while (value >= 100) {
+		size_t pair = 2 * (value % 100);
+		value /= 100;
+		digits[--pos] = decimal_digits[pair + 1];
+		digits[--pos] = decimal_digits[pair];
+	}
+
+	// The last one or two digits
+	if (value >= 10) {
+		digits[--pos] = decimal_digits[2 * value + 1];
+		digits[--pos] = decimal_digits[2 * value];
+	} else {
+		digits[--pos] = '0' + value;
+	}
+
+	output_text(output, digits + pos, NUMBER_SIZE - pos);
+}
@@ -0,0 +1,457 @@
+// mmap() and MAP_ANONYMOUS are not part of C99
+#define _DEFAULT_SOURCE
+
+#include <sys/mman.h>
+
+#include "../header.h"
+
+// This file defines malloc() and the functions around it, so their names must
+// not be turned into the ones of the metadata functions
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+// The arenas of the program, created on the first allocation
+static arenas_t arenas = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+void *map_memory(size_t size, size_t alignment)
+{
+	// Leave room for the header before the memory and for the alignment
+	if (size > SIZE_MAX - alignment - sizeof(mapping_t))
+		return NULL;
+	size_t length = size + alignment + sizeof(mapping_t);
+
+	void *base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+
+	// Place the memory at the first aligned address after the header
+	size_t pointer = ((size_t)base + sizeof(mapping_t) + alignment - 1) &
+					 ~(alignment - 1);
+
+	// Remember the mapping, so the memory can be unmapped
+	mapping_t *mapping = (mapping_t *)pointer - 1;
+	mapping->base = base;
+	mapping->length = length;
+
+	return (void *)pointer;
+}
+
+mapping_t *find_mapping(void *pointer)
+{
+	// The header is right before the memory
+	return (mapping_t *)pointer - 1;
+}
+
+void *meta_malloc(size_t size)
+{
+	// The metadata is small and grows by doubling, so it is mapped on its own
+	return map_memory(size, PRELOAD_ALIGNMENT);
+}
+
+void *meta_calloc(size_t count, size_t size)
+{
+	// Check that the total size does not overflow
+	if (size && count > SIZE_MAX / size)
+		return NULL;
+
+	// A new mapping is already filled with zeros
+	return map_memory(count * size, PRELOAD_ALIGNMENT);
+}
+
+void *meta_realloc(void *pointer, size_t size)
+{
+	// Allocate new memory if there was none
+	if (!pointer)
+		return meta_malloc(size);
+
+	void *memory = meta_malloc(size);
+	if (!memory)
+		return NULL;
+
+	// Copy the bytes which fit in the new memory, then free the old one
+	mapping_t *mapping = find_mapping(pointer);
+	size_t old_size = (size_t)mapping->base + mapping->length - (size_t)pointer;
+	memcpy(memory, pointer, old_size < size ? old_size : size);
+	meta_free(pointer);
+
+	return memory;
+}
+
+void meta_free(void *pointer)
+{
+	// Do nothing for free(NULL)
+	if (!pointer)
+		return;
+
+	mapping_t *mapping = find_mapping(pointer);
+	munmap(mapping->base, mapping->length);
+}
+
+void arenas_setup(arenas_t *arenas)
+{
+	// Start with the default parameters
+	arenas->lists_num = PRELOAD_LISTS_NUM;
+	arenas->bytes_per_list = PRELOAD_BYTES_PER_LIST;
+	arenas->reconstruct_type = 1;
+	arenas->policy = SFL_BEST_FIT;
+	arenas->magazines = false;
+
+	// Replace the ones given in the environment, if they are valid
+	char *value = getenv("SFL_LISTS_NUM");
+	if (value && strtoul(value, NULL, 10) >= 2 &&
+		strtoul(value, NULL, 10) <= 40)
+		arenas->lists_num = strtoul(value, NULL, 10);
+
+	value = getenv("SFL_BYTES_PER_LIST");
+	if (value && strtoul(value, NULL, 10))
+		arenas->bytes_per_list = strtoul(value, NULL, 10);
+
+	// Every non-zero type other than the buddy system unites all neighbours
+	value = getenv("SFL_RECONSTRUCT_TYPE");
+	if (value && strtoul(value, NULL, 10) == RECONSTRUCT_BUDDY)
+		arenas->reconstruct_type = RECONSTRUCT_BUDDY;
+	else if (value)
+		arenas->reconstruct_type = strtoul(value, NULL, 10) != 0;
+
+	value = getenv("SFL_POLICY");
+	if (value && find_policy(value) != SFL_POLICIES)
+		arenas->policy = find_policy(value);
+
+	value = getenv("SFL_MAGAZINES");
+	if (value)
+		arenas->magazines = strtoul(value, NULL, 10) != 0;
+
+	// Keep every list aligned, so every block given is aligned too
+	arenas->bytes_per_list = (arenas->bytes_per_list + PRELOAD_ALIGNMENT - 1) &
+							 ~(size_t)(PRELOAD_ALIGNMENT - 1);
+
+	// Hold every lock across a fork, so the child does not inherit one held
+	// by a thread which does not exist in it
+	pthread_atfork(arenas_lock, arenas_unlock, arenas_unlock);
+
+	arenas->ready = true;
+}
+
+void arenas_lock(void)
+{
+	// Take the lock of the arenas before the locks of the heaps, in the order
+	// every other function takes them
+	pthread_mutex_lock(&arenas.lock);
+	for (size_t i = 0; i < arenas.count; i++)
+		pthread_mutex_lock(&arenas.heaps[i]->lock);
+}
+
+void arenas_unlock(void)
+{
+	// Give the locks back in the reverse order
+	for (size_t i = arenas.count; i > 0; i--)
+		pthread_mutex_unlock(&arenas.heaps[i - 1]->lock);
+	pthread_mutex_unlock(&arenas.lock);
+}
+
+sfl_heap_t *arena_create(arenas_t *arenas)
+{
+	// Grow the array of arenas if it is full
+	if (arenas->count == arenas->capacity) {
+		size_t capacity = arenas->capacity ? 2 * arenas->capacity : 8;
+
+		sfl_heap_t **heaps =
+			meta_realloc(arenas->heaps, capacity * sizeof(sfl_heap_t *));
+		if (!heaps)
+			return NULL;
+
+		arenas->heaps = heaps;
+		arenas->capacity = capacity;
+	}
+
+	// Create the heap, whose data is mapped by meta_malloc(), and use the real
+	// addresses of its data as its addresses
+	sfl_heap_t *heap = sfl_init(1, arenas->lists_num, arenas->bytes_per_list,
+								arenas->reconstruct_type);
+	heap->start_address = (size_t)heap->sfl.heap_data;
+	sfl_set_policy(heap, arenas->policy);
+	sfl_set_magazines(heap, arenas->magazines);
+
+	arenas->current = arenas->count;
+	arenas->heaps[arenas->count++] = heap;
+
+	return heap;
+}
+
+sfl_heap_t *arena_find(arenas_t *arenas, size_t address)
+{
+	size_t arena_size = arenas->lists_num * arenas->bytes_per_list;
+
+	// Check the range of the data of every arena
+	for (size_t i = 0; i < arenas->count; i++) {
+		sfl_heap_t *heap = arenas->heaps[i];
+		if (address - heap->start_address < arena_size)
+			return heap;
+	}
+
+	return NULL;
+}
+
+size_t arena_block(sfl_heap_t *heap, size_t alignment, size_t size)
+{
+	// Every block is aligned to PRELOAD_ALIGNMENT, only the stricter
+	// alignments need an aligned block
+	if (alignment <= PRELOAD_ALIGNMENT)
+		return malloc_f(heap, size);
+
+	return memalign_f(heap, alignment, size);
+}
+
+void *arena_malloc(arenas_t *arenas, size_t alignment, size_t size)
+{
+	// Try the current arena first, since the last block came from it
+	if (arenas->count) {
+		sfl_heap_t *heap = arenas->heaps[arenas->current];
+		size_t block_address = arena_block(heap, alignment, size);
+		if (block_address != NO_BLOCK)
+			return (char *)heap->sfl.heap_data + block_address;
+	}
+
+	// Try the other arenas, the first one with enough memory becoming the
+	// current one
+	for (size_t i = 0; i < arenas->count; i++) {
+		if (i == arenas->current)
+			continue;
+
+		sfl_heap_t *heap = arenas->heaps[i];
+		size_t block_address = arena_block(heap, alignment, size);
+		if (block_address != NO_BLOCK) {
+			arenas->current = i;
+			return (char *)heap->sfl.heap_data + block_address;
+		}
+	}
+
+	// Create a new arena if all of them are out of memory
+	sfl_heap_t *heap = arena_create(arenas);
+	if (!heap)
+		return NULL;
+
+	size_t block_address = arena_block(heap, alignment, size);
+	if (block_address == NO_BLOCK)
+		return NULL;
+
+	return (char *)heap->sfl.heap_data + block_address;
+}
+
+size_t usable_size(arenas_t *arenas, void *pointer)
+{
+	// A block of an arena holds exactly the size it was allocated with
+	sfl_heap_t *heap = arena_find(arenas, (size_t)pointer);
+	if (heap) {
+		tree_t *allocated_blocks = &heap->allocated_blocks;
+		size_t node = tree_find(allocated_blocks,
+								(size_t)pointer - heap->start_address);
+
+		return node == NO_BLOCK ? 0 : allocated_blocks->nodes[node].size;
+	}
+
+	// A block mapped on its own holds everything until the end of its mapping
+	mapping_t *mapping = find_mapping(pointer);
+	return (size_t)mapping->base + mapping->length - (size_t)pointer;
+}
+
+PRELOAD_EXPORT void *malloc(size_t size)
+{
+	// Round the size up, so every block of the arenas stays aligned
+	if (size > SIZE_MAX - PRELOAD_ALIGNMENT) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	size = (size + PRELOAD_ALIGNMENT - 1) & ~(size_t)(PRELOAD_ALIGNMENT - 1);
+
+	// An empty block would share its address with the block after it
+	if (!size)
+		size = PRELOAD_ALIGNMENT;
+
+	pthread_mutex_lock(&arenas.lock);
+	if (!arenas.ready)
+		arenas_setup(&arenas);
+
+	// The blocks larger than the largest block of an arena are mapped on
+	// their own
+	void *pointer = NULL;
+	bool mapped = size > 8 * ((size_t)1 << (arenas.lists_num - 1));
+	if (!mapped)
+		pointer = arena_malloc(&arenas, PRELOAD_ALIGNMENT, size);
+	pthread_mutex_unlock(&arenas.lock);
+
+	if (mapped)
+		pointer = map_memory(size, PRELOAD_ALIGNMENT);
+
+	if (!pointer)
+		errno = ENOMEM;
+
+	return pointer;
+}
+
+PRELOAD_EXPORT void free(void *pointer)
+{
+	// Do nothing for free(NULL)
+	if (!pointer)
+		return;
+
+	// Give the block back to its arena, or unmap it if it has none
+	pthread_mutex_lock(&arenas.lock);
+	sfl_heap_t *heap = arena_find(&arenas, (size_t)pointer);
+	if (heap)
+		free_f(heap, (size_t)pointer);
+	pthread_mutex_unlock(&arenas.lock);
+
+	if (!heap)
+		meta_free(pointer);
+}
+
+PRELOAD_EXPORT void *calloc(size_t count, size_t size)
+{
+	// Check that the total size does not overflow
+	if (size && count > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	void *pointer = malloc(count * size);
+	if (!pointer)
+		return NULL;
+
+	// The blocks of the arenas may hold the bytes of a freed block, while the
+	// mapped ones are already filled with zeros
+	pthread_mutex_lock(&arenas.lock);
+	bool reused = arena_find(&arenas, (size_t)pointer) != NULL;
+	pthread_mutex_unlock(&arenas.lock);
+
+	if (reused)
+		memset(pointer, 0, count * size);
+
+	return pointer;
+}
+
+PRELOAD_EXPORT void *realloc(void *pointer, size_t size)
+{
+	// Allocate a new block if there was none
+	if (!pointer)
+		return malloc(size);
+
+	// Free the block for realloc(pointer, 0)
+	if (!size) {
+		free(pointer);
+		return NULL;
+	}
+
+	// Keep the block if it is already large enough
+	pthread_mutex_lock(&arenas.lock);
+	size_t old_size = usable_size(&arenas, pointer);
+	pthread_mutex_unlock(&arenas.lock);
+
+	if (size <= old_size)
+		return pointer;
+
+	// Move the bytes to a larger block otherwise
+	void *memory = malloc(size);
+	if (!memory)
+		return NULL;
+
+	memcpy(memory, pointer, old_size);
+	free(pointer);
+
+	return memory;
+}
+
+PRELOAD_EXPORT void *aligned_alloc(size_t alignment, size_t size)
+{
+	// The alignment must be a power of two
+	if (!alignment || (alignment & (alignment - 1))) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	// Every block is aligned to PRELOAD_ALIGNMENT
+	if (alignment <= PRELOAD_ALIGNMENT)
+		return malloc(size);
+
+	if (size > SIZE_MAX - alignment) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	size = (size + PRELOAD_ALIGNMENT - 1) & ~(size_t)(PRELOAD_ALIGNMENT - 1);
+	if (!size)
+		size = PRELOAD_ALIGNMENT;
+
+	pthread_mutex_lock(&arenas.lock);
+	if (!arenas.ready)
+		arenas_setup(&arenas);
+
+	// The stricter alignments are split off a block of an arena, if a block
+	// of an arena can hold the size after skipping up to the alignment, and
+	// are mapped on their own otherwise
+	void *pointer = NULL;
+	bool mapped = size + alignment > 8 * ((size_t)1 << (arenas.lists_num - 1));
+	if (!mapped)
+		pointer = arena_malloc(&arenas, alignment, size);
+	pthread_mutex_unlock(&arenas.lock);
+
+	if (mapped)
+		pointer = map_memory(size, alignment);
+
+	if (!pointer)
+		errno = ENOMEM;
+
+	return pointer;
+}
+
+PRELOAD_EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	// The alignment must also be a multiple of a pointer
+	if (!alignment || (alignment & (alignment - 1)) ||
+		alignment % sizeof(void *))
+		return EINVAL;
+
+	void *pointer = aligned_alloc(alignment, size);
+	if (!pointer)
+		return ENOMEM;
+
+	*memptr = pointer;
+	return 0;
+}
+
+PRELOAD_EXPORT void *memalign(size_t alignment, size_t size)
+{
+	return aligned_alloc(alignment, size);
+}
+
+PRELOAD_EXPORT void *valloc(size_t size)
+{
+	return aligned_alloc(PRELOAD_PAGE_SIZE, size);
+}
+
+PRELOAD_EXPORT void *pvalloc(size_t size)
+{
+	// Round the size up to a whole number of pages
+	if (size > SIZE_MAX - PRELOAD_PAGE_SIZE) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return aligned_alloc(PRELOAD_PAGE_SIZE, (size + PRELOAD_PAGE_SIZE - 1) &
+												~(size_t)(PRELOAD_PAGE_SIZE - 1));
+}
+
+PRELOAD_EXPORT size_t malloc_usable_size(void *pointer)
+{
+	// A missing block holds nothing
+	if (!pointer)
+		return 0;
+
+	pthread_mutex_lock(&arenas.lock);
+	size_t size = usable_size(&arenas, pointer);
+	pthread_mutex_unlock(&arenas.lock);
+
+	return size;
+}
@@ -1,232 +1,345 @@
 #include "../header.h"
 
-bool read(list_t allocated_blocks, void *heap_data, size_t start_address,
-		  char *command, size_t free_calls, size_t fragmentations,
-		  size_t malloc_calls, list_t *sfl_lists, size_t lists_num)
+// The buffer the addresses and the read bytes are formatted in, reused by
+// every command
+static output_t output;
+
+#ifdef SFL_PROFILE
+// The names of the walks of the profile, in the order of walk_t
+static const char *walk_names[] = {
+	"Tree search steps",
+	"Pool probes",
+	"Blocks crossed by READ and WRITE",
+	"Lists compared by first-fit",
+};
+
+// The names of the arrays which grow, in the order of growth_t
+static const char *growth_names[] = {
+	"pool records",
+	"pool table",
+	"allocated block nodes",
+};
+#endif
+
+bool read(sfl_heap_t *heap, size_t block_address, size_t read_size)
 {
-	// Declare the variables read for the input
-	size_t block_address, read_size;
+	// Print the bytes straight from the heap if every one of them is
+	// allocated, since the blocks are contiguous in the heap
+	size_t offset = block_address - heap->start_address;
+	if (find_span(&heap->allocated_blocks, offset, read_size)) {
+		// The text ends at its first null byte
+		const char *text = (char *)heap->sfl.heap_data + offset;
+		const char *end = memchr(text, '\0', read_size);
+		if (end)
+			read_size = end - text;
+
+		output_text(&output, text, read_size);
+		output_text(&output, "\n", 1);
+		output_flush(&output);
+
+		// Return true if the text is read completely
+		return true;
+	}
 
-	// Read the address and the size of the block to be read
-	scanf("%lx %lu", &block_address, &read_size);
+	// If the range is not allocated, print an error message
+	printf("Segmentation fault (core dumped)\n");
 
-	// Allocate memory for the block
-	char *text = malloc(read_size + 1);
-	DIE(!text, "Malloc failed while allocating text");
+	// Dump the memory statistics
+	dump_memory(heap);
 
-	// Make an index for the text
-	size_t j = 0;
+	// Destroy the heap
+	sfl_destroy(heap);
 
-	// Counter for the number of bytes read
-	size_t read = 0;
+	// Return false if the text is not read completely
+	return false;
+}
 
-	// Make an index for the allocated block
-	size_t i = 0;
+bool write(sfl_heap_t *heap, size_t block_address, const char *text,
+		   size_t text_length, size_t write_size)
+{
+	// Only the given text can be written, even if the size is larger, and it
+	// ends at its first null byte
+	const char *end = memchr(text, '\0', text_length);
+	if (end)
+		text_length = end - text;
+	if (write_size > text_length)
+		write_size = text_length;
+
+	// Copy the bytes straight from the input if every one of them is
+	// allocated, nothing being written otherwise
+	if (sfl_write(heap, block_address, text, write_size))
+		return true;
+
+	// If the range is not allocated, print an error message
+	printf("Segmentation fault (core dumped)\n");
 
-	// Find the block with the given address
-	for (node_t *current = allocated_blocks.head; current;
-		 current = current->next) {
-		// Check if the address is found
-		if (block_address !=
-			(size_t)((block_t *)(size_t)current->data)->address -
-				(size_t)heap_data + start_address)
-			continue;
+	// Dump the memory statistics
+	dump_memory(heap);
 
-		// Copy the data from the allocated memory to the text
-		for (i = 0, read = 0;
-			 i < read_size && i < ((block_t *)(size_t)current->data)->size;
-			 i++, read++)
-			text[j++] =
-				*((char *)((block_t *)(size_t)current->data)->address + i);
+	// Destroy the heap
+	sfl_destroy(heap);
 
-		// Update the size and address
-		read_size -= read;
-		block_address += read;
+	// Return false if the block is not written completely
+	return false;
+}
 
-		// Check if the text is read completely
-		if (read_size == 0) {
-			// Add the null terminator
-			text[j] = '\0';
+void dump_memory(sfl_heap_t *heap)
+{
+	printf("+++++DUMP+++++\n");
 
-			// Print the text
-			printf("%s\n", text);
+	// Get the totals of the heap
+	sfl_stats_t stats;
+	sfl_stats(heap, &stats);
 
-			// Free the memory of the text
-			free(text);
+	// Print the total memory, total allocated memory, total free memory,
+	// number of free blocks, number of allocated blocks, number of malloc
+	// calls, number of fragmentations, and number of free calls
 
-			// Return true if the text is read completely
-			return true;
+	printf("Total memory: %lu bytes\n", stats.total_memory);
+	printf("Total allocated memory: %lu bytes\n", stats.allocated_memory);
+	printf("Total free memory: %lu bytes\n", stats.free_memory);
+	printf("Free blocks: %lu\n", stats.free_blocks);
+	printf("Number of allocated blocks: %lu\n",
+		   stats.malloc_calls - stats.free_calls);
+	printf("Number of malloc calls: %lu\n", stats.malloc_calls);
+	printf("Number of fragmentations: %lu\n", stats.fragmentations);
+	printf("Number of free calls: %lu\n", stats.free_calls);
+
+	// Get the lists, the allocated blocks and the start of the heap
+	sfl_t *sfl = &heap->sfl;
+	tree_t *allocated_blocks = &heap->allocated_blocks;
+	tree_node_t *blocks = allocated_blocks->nodes;
+	size_t start_address = heap->start_address;
+
+	// Print blocks with their respective sizes and number of free blocks, the
+	// sizes with a non-empty list or magazine; there can be an address for
+	// every block of the heap, so they are formatted in the output buffer
+	size_t i = bitmap_next(&sfl->used, 0);
+	if (magazine_next(heap, 0) < i)
+		i = magazine_next(heap, 0);
+
+	while (i <= sfl->max_size) {
+		list_t *list = find_list(sfl, i);
+
+		// Get the blocks kept by the magazine of the size, in address order
+		size_t cached[MAGAZINE_DEPTH];
+		size_t cached_num = magazine_sorted(heap, i, cached), k = 0;
+
+		output_string(&output, "Blocks with ");
+		output_decimal(&output, i);
+		output_string(&output, " bytes - ");
+		output_decimal(&output, list->size + cached_num);
+		output_string(&output, " free block(s) : ");
+
+		// Get the uncarved blocks of the list, if there are any
+		region_t *region = find_region(sfl, i);
+		size_t uncarved = region ? region->next : 0;
+		size_t end = region ? region->end : 0;
+
+		// Print the addresses of the free blocks, merging the nodes of the
+		// list, the uncarved blocks and the kept ones in order
+		size_t current = list->linked ? list->head : NO_BLOCK;
+		for (size_t j = 0; j < list->size + cached_num; j++) {
+			size_t address = k < cached_num ? cached[k] : NO_BLOCK;
+			if (current != NO_BLOCK &&
+				free_block(sfl, i, current)->address < address &&
+				(uncarved == end ||
+				 free_block(sfl, i, current)->address < uncarved)) {
+				address = free_block(sfl, i, current)->address;
+				current = free_block(sfl, i, current)->next;
+			} else if (uncarved != end && uncarved < address &&
+					   (current == NO_BLOCK ||
+						uncarved < free_block(sfl, i, current)->address)) {
+				address = uncarved;
+				uncarved += i;
+			} else {
+				k += 1;
+			}
+
+			// Print a space if there were blocks before
+			if (j)
+				output_text(&output, " ", 1);
+
+			output_hex(&output, address + start_address);
 		}
-	}
 
-	// If the address is not found, print an error message
-	printf("Segmentation fault (core dumped)\n");
-
-	// Free the memory of the text
-	free(text);
+		output_text(&output, "\n", 1);
 
-	// Dump the memory statistics
-	dump_memory(lists_num, malloc_calls, fragmentations, free_calls, sfl_lists,
-				allocated_blocks, start_address, heap_data);
+		// Go to the next size with a non-empty list or magazine
+		size_t next = magazine_next(heap, i + 1);
+		i = bitmap_next(&sfl->used, i + 1);
+		if (next < i)
+			i = next;
+	}
 
-	// Destroy the heap
-	destroy_heap(sfl_lists, lists_num, heap_data, allocated_blocks);
+	// Print the addresses of the allocated blocks
+	output_string(&output, "Allocated blocks :");
+	if (allocated_blocks->head != NO_BLOCK) {
+		output_text(&output, " ", 1);
+
+		for (size_t current = allocated_blocks->head; current != NO_BLOCK;
+			 current = blocks[current].next) {
+			output_text(&output, "(", 1);
+			output_hex(&output, blocks[current].address + start_address);
+			output_text(&output, " - ", 3);
+			output_decimal(&output, blocks[current].size);
+			output_text(&output, ")", 1);
 
-	// Free the command
-	free(command);
+			// Print a space if there are more blocks
+			if (blocks[current].next != NO_BLOCK)
+				output_text(&output, " ", 1);
+		}
+	}
 
-	// Return false if the text is not read completely
-	return false;
+	output_string(&output, "\n-----DUMP-----\n");
+	output_flush(&output);
 }
 
-bool write(list_t allocated_blocks, void *heap_data, size_t start_address,
-		   char *command, size_t free_calls, size_t fragmentations,
-		   size_t malloc_calls, list_t *sfl_lists, size_t lists_num)
+void print_stats(sfl_heap_t *heap)
 {
-	// Declare the variables read for the input
-	size_t block_address, write_size;
+	printf("+++++STATS+++++\n");
+
+	// Get the totals of the heap
+	sfl_stats_t stats;
+	sfl_stats(heap, &stats);
+
+	printf("Total memory: %lu bytes\n", stats.total_memory);
+	printf("Total allocated memory: %lu bytes\n", stats.allocated_memory);
+	printf("Total free memory: %lu bytes\n", stats.free_memory);
+	printf("Free blocks: %lu\n", stats.free_blocks);
+	printf("Live blocks: %lu\n", stats.allocated_blocks);
+	printf("Largest free block: %lu bytes\n", stats.largest_free_block);
+	printf("Resident memory: %lu bytes\n", stats.resident_memory);
+	printf("Released memory: %lu bytes\n", stats.released_memory);
+
+	// Print how well the placement policy keeps the free memory together
+	printf("Placement policy: %s\n", policy_name(stats.policy));
+	printf("Splits: %lu\n", stats.fragmentations);
+	printf("Wasted memory: %lu bytes\n", stats.wasted_memory);
+
+	// The share of the free memory outside of the largest free block
+	double fragmentation = 0;
+	if (stats.free_memory)
+		fragmentation = 100.0 *
+						(stats.free_memory - stats.largest_free_block) /
+						stats.free_memory;
+	printf("External fragmentation: %.2f%%\n", fragmentation);
+
+	// Print the number of free blocks of every non-empty size class
+	for (size_t i = 0; i < SFL_CLASSES; i++) {
+		if (!stats.class_blocks[i])
+			continue;
 
-	// Read the address and the size of the block to be written
-	scanf("%lx", &block_address);
+		printf("Free blocks of %lu-%lu bytes: %lu\n", (size_t)1 << i,
+			   ((size_t)1 << i << 1) - 1, stats.class_blocks[i]);
+	}
 
-	// Read the block
-	char *text = read_text();
+	printf("-----STATS-----\n");
+}
 
-	// Read the size of the block to be written
-	scanf("%lu", &write_size);
+void print_frag_report(sfl_heap_t *heap)
+{
+	printf("+++++FRAG_REPORT+++++\n");
 
-	// Calculate the original text size
-	size_t text_size = strlen(text);
+	// Get the totals of the heap, which are kept up to date by every command
+	sfl_stats_t stats;
+	sfl_stats(heap, &stats);
 
-	// Make an index for the allocated block
-	size_t i;
+	printf("Total free memory: %lu bytes\n", stats.free_memory);
+	printf("Largest free block: %lu bytes\n", stats.largest_free_block);
 
-	// Make an index for the soon-to-be-written block
-	size_t j = 0;
+	// The share of the free memory which cannot be given to a single request
+	double index = 0;
+	if (stats.free_memory)
+		index = 1.0 - (double)stats.largest_free_block / stats.free_memory;
+	printf("External fragmentation index: %.4f\n", index);
 
-	// Find the block with the given address
-	for (node_t *current = allocated_blocks.head; current;
-		 current = current->next) {
-		// Check if the address is found
-		if (block_address !=
-			(size_t)((block_t *)(size_t)current->data)->address -
-				(size_t)heap_data + start_address)
+	// Print the free blocks and bytes of every non-empty size class
+	for (size_t i = 0; i < SFL_CLASSES; i++) {
+		if (!stats.class_blocks[i])
 			continue;
 
-		// Copy the data from the text to the allocated memory
-		for (i = 0;
-			 i < write_size && i < ((block_t *)(size_t)current->data)->size &&
-			 i < text_size;
-			 i++, j++) {
-			*((char *)((block_t *)(size_t)current->data)->address + i) =
-				text[j];
-		}
-
-		// Update the size, address and text size
-		write_size -= i;
-		text_size -= i;
-		block_address += i;
-
-		// Check if the text is written completely and return true
-		if (write_size == 0 || text_size == 0) {
-			// Free the memory of the block
-			free(text);
-
-			// Return true if the text is written completely
-			return true;
-		}
+		printf("Free blocks of %lu-%lu bytes: %lu (%lu bytes)\n",
+			   (size_t)1 << i, ((size_t)1 << i << 1) - 1,
+			   stats.class_blocks[i], stats.class_memory[i]);
 	}
 
-	// If the address is not found, print an error message
-	printf("Segmentation fault (core dumped)\n");
-
-	// Dump the memory statistics
-	dump_memory(lists_num, malloc_calls, fragmentations, free_calls, sfl_lists,
-				allocated_blocks, start_address, heap_data);
-
-	// Destroy the heap
-	destroy_heap(sfl_lists, lists_num, heap_data, allocated_blocks);
+	// Print the occupancy of every initial list, which holds the parent
+	// blocks of the blocks carved from it
+	size_t regions_num = sfl_regions(heap, NULL, 0);
+	sfl_region_t *regions = malloc(regions_num * sizeof(sfl_region_t));
+	DIE(!regions, "Malloc failed while allocating regions");
+	sfl_regions(heap, regions, regions_num);
+
+	for (size_t i = 0; i < regions_num; i++) {
+		double occupancy = 0;
+		if (regions[i].size)
+			occupancy = 100.0 * regions[i].allocated_memory / regions[i].size;
+
+		printf("Parent blocks of %lu bytes: %lu/%lu bytes allocated "
+			   "(%.2f%%) in %lu blocks\n",
+			   regions[i].parent_size, regions[i].allocated_memory,
+			   regions[i].size, occupancy, regions[i].allocated_blocks);
+	}
 
-	// Free the command and the block
-	free(command);
-	free(text);
+	free(regions);
 
-	// Return false if the block is not written completely
-	return false;
+	printf("-----FRAG_REPORT-----\n");
 }
 
-void dump_memory(size_t lists_num, size_t malloc_calls, size_t fragmentations,
-				 size_t free_calls, list_t *sfl_lists,
-				 list_t allocated_blocks, size_t start_address,
-				 void *heap_data)
+void print_histogram(const char *name, histogram_t *histogram)
 {
-	printf("+++++DUMP+++++\n");
+	// Skip the histograms without values
+	if (!histogram->count)
+		return;
 
-	// Calculate the number of free blocks and the total free memory
-	size_t free_blocks = 0;
-	size_t free_memory = 0;
-	for (size_t i = 0; i < lists_num; i++) {
-		free_blocks += sfl_lists[i].size;
-		free_memory +=
-			sfl_lists[i].size * ((block_t *)sfl_lists[i].head->data)->size;
-	}
+	printf("%s: count %lu, mean %lu, max %lu\n", name, histogram->count,
+		   histogram->total / histogram->count, histogram->max);
 
-	// Calculate the total allocated memory
-	size_t allocated_memory = 0;
-	for (node_t *current = allocated_blocks.head; current;
-		 current = current->next) {
-		allocated_memory += ((block_t *)current->data)->size;
-	}
+	// Print the range of every non-empty bucket
+	for (size_t i = 0; i < PROFILE_BUCKETS; i++) {
+		if (!histogram->buckets[i])
+			continue;
 
-	// Print the total memory, total allocated memory, total free memory,
-	// number of free blocks, number of allocated blocks, number of malloc
-	// calls, number of fragmentations, and number of free calls
+		if (i < 2)
+			printf("  %lu: %lu\n", i, histogram->buckets[i]);
+		else
+			printf("  %lu-%lu: %lu\n", (size_t)1 << (i - 1),
+				   ((size_t)1 << (i - 1) << 1) - 1, histogram->buckets[i]);
+	}
+}
 
-	printf("Total memory: %lu bytes\n", free_memory + allocated_memory);
-	printf("Total allocated memory: %lu bytes\n", allocated_memory);
-	printf("Total free memory: %lu bytes\n", free_memory);
-	printf("Free blocks: %lu\n", free_blocks);
-	printf("Number of allocated blocks: %lu\n", malloc_calls - free_calls);
-	printf("Number of malloc calls: %lu\n", malloc_calls);
-	printf("Number of fragmentations: %lu\n", fragmentations);
-	printf("Number of free calls: %lu\n", free_calls);
-
-	// Print blocks with their respective sizes and number of free blocks
-	for (size_t i = 0; i < lists_num; i++) {
-		printf("Blocks with %lu bytes - %lu free block(s) : ",
-			   ((block_t *)sfl_lists[i].head->data)->size, sfl_lists[i].size);
-
-		// Print the addresses of the free blocks
-		for (node_t *current = sfl_lists[i].head; current;
-			 current = current->next) {
-			printf("0x%lx", (size_t)((block_t *)current->data)->address -
-								(size_t)heap_data + start_address);
+void print_profile(sfl_heap_t *heap)
+{
+	printf("+++++PROFILE+++++\n");
 
-			// Print a space if there are more blocks
-			if (current->next)
-				printf(" ");
-		}
+#ifdef SFL_PROFILE
+	profile_t *profile = &heap->profile;
+	pthread_mutex_lock(&heap->lock);
 
-		printf("\n");
+	// Print the latencies of every command which was given
+	char name[COMMAND_SIZE];
+	for (size_t i = 0; i < COMMAND_EOF; i++) {
+		snprintf(name, COMMAND_SIZE, "%s latency (ns)", command_name(i));
+		print_histogram(name, &profile->latencies[i]);
 	}
 
-	// Print the addresses of the allocated blocks
-	printf("Allocated blocks :");
-	if (allocated_blocks.head) {
-		printf(" ");
+	// Print the lengths of the walks and the merges of the frees
+	for (size_t i = 0; i < WALKS; i++)
+		print_histogram(walk_names[i], &profile->walks[i]);
+	print_histogram("Merges per FREE", &profile->merges);
 
-		for (node_t *current = allocated_blocks.head; current;
-			 current = current->next) {
-			printf("(0x%lx - %lu)",
-				   (size_t)((block_t *)current->data)->address -
-					   (size_t)heap_data + start_address,
-				   ((block_t *)current->data)->size);
+	// Print how many times the arrays grew
+	for (size_t i = 0; i < GROWTHS; i++)
+		printf("Reallocations of the %s: %lu\n", growth_names[i],
+			   profile->growths[i]);
 
-			// Print a space if there are more blocks
-			if (current->next)
-				printf(" ");
-		}
-	}
+	pthread_mutex_unlock(&heap->lock);
+#else
+	// The instrumentation is left out of the other builds
+	(void)heap;
+	printf("Profiling is disabled, build with make PROFILE=1\n");
+#endif
 
-	printf("\n-----DUMP-----\n");
+	printf("-----PROFILE-----\n");
 }
@@ -0,0 +1,644 @@
+// mmap(), fileno() and mkstemp() are not part of C99
+#define _DEFAULT_SOURCE
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../header.h"
+
+bool snapshot_put(FILE *file, const void *data, size_t size)
+{
+	// Nothing has to be written for the empty arrays
+	return !size || fwrite(data, size, 1, file) == 1;
+}
+
+bool snapshot_take(void *data, const char *file_data, size_t *offset,
+				   size_t limit, size_t size)
+{
+	// The array must be inside the file
+	if (size > limit - *offset)
+		return false;
+
+	// Nothing has to be copied for the empty arrays
+	if (!size)
+		return true;
+
+	memcpy(data, file_data + *offset, size);
+	*offset += size;
+
+	return true;
+}
+
+size_t snapshot_words(bitmap_t *bitmap, size_t level)
+{
+	// A level has a word for every 64 bits, and at least one word
+	size_t bits = bitmap->counts[level];
+	return bits ? (bits + 63) / 64 : 1;
+}
+
+bool snapshot_put_bitmap(FILE *file, bitmap_t *bitmap)
+{
+	// The shape of the bitmap comes from its number of bits, so only the
+	// words of every level are written
+	for (size_t level = 0; level < bitmap->levels; level++) {
+		if (!snapshot_put(file, bitmap->words[level],
+						  snapshot_words(bitmap, level) * sizeof(uint64_t)))
+			return false;
+	}
+
+	return true;
+}
+
+bool snapshot_take_bitmap(bitmap_t *bitmap, const char *file_data,
+						  size_t *offset, size_t limit)
+{
+	// The bitmap already has the shape of the one which was written
+	for (size_t level = 0; level < bitmap->levels; level++) {
+		if (!snapshot_take(bitmap->words[level], file_data, offset, limit,
+						   snapshot_words(bitmap, level) * sizeof(uint64_t)))
+			return false;
+	}
+
+	// The upper levels only summarise the bottom one, so they are rebuilt
+	// from it rather than trusted, and so are the bits past its end
+	if (bitmap->bits % 64)
+		bitmap->words[0][bitmap->bits / 64] &=
+			((uint64_t)1 << (bitmap->bits % 64)) - 1;
+
+	for (size_t level = 1; level < bitmap->levels; level++) {
+		memset(bitmap->words[level], 0,
+			   snapshot_words(bitmap, level) * sizeof(uint64_t));
+		for (size_t i = 0; i < snapshot_words(bitmap, level - 1); i++)
+			if (bitmap->words[level - 1][i])
+				bitmap->words[level][i / 64] |= (uint64_t)1 << (i % 64);
+	}
+
+	return true;
+}
+
+bool snapshot_index(size_t index, size_t count)
+{
+	// A missing record is the only index allowed past the end of its array
+	return index == NO_BLOCK || index < count;
+}
+
+bool snapshot_valid(snapshot_t *snapshot, size_t file_size)
+{
+	// The heap data has to fit in the file after the arrays, its size not
+	// overflowing
+	if (memcmp(snapshot->magic, SNAPSHOT_MAGIC, sizeof(snapshot->magic)) ||
+		snapshot->lists_num < 1 || snapshot->lists_num > 40 ||
+		!snapshot->bytes_per_list ||
+		snapshot->bytes_per_list > SIZE_MAX / snapshot->lists_num ||
+		snapshot->data_offset % HEAP_PAGE_SIZE ||
+		snapshot->data_offset < sizeof(snapshot_t) ||
+		file_size < snapshot->data_offset ||
+		file_size - snapshot->data_offset <
+			snapshot->lists_num * snapshot->bytes_per_list)
+		return false;
+
+	// Every array has to fit before the heap data, which is checked before
+	// any of them is allocated
+	size_t limit = snapshot->data_offset - sizeof(snapshot_t);
+	if (snapshot->list_pages >
+			limit / (sizeof(size_t) + LIST_PAGE_SIZE * sizeof(list_t)) ||
+		snapshot->pool_capacity > limit / sizeof(block_t) ||
+		snapshot->pool_table_size > limit / sizeof(size_t) ||
+		snapshot->tree_capacity > limit / sizeof(tree_node_t) ||
+		snapshot->cached_capacity > limit / sizeof(tree_node_t))
+		return false;
+
+	// The table of the pool is hashed with a mask, and always keeps an empty
+	// slot to end its probes
+	if ((snapshot->pool_table_size & (snapshot->pool_table_size - 1)) ||
+		snapshot->pool_used > snapshot->pool_capacity ||
+		2 * snapshot->pool_used > snapshot->pool_table_size)
+		return false;
+
+	// Every index has to be inside its array
+	return snapshot->magazines <= 1 &&
+		   snapshot_index(snapshot->pool_free_head, snapshot->pool_capacity) &&
+		   snapshot_index(snapshot->tree_free_head, snapshot->tree_capacity) &&
+		   snapshot_index(snapshot->tree_root, snapshot->tree_capacity) &&
+		   snapshot_index(snapshot->tree_head, snapshot->tree_capacity) &&
+		   snapshot->tree_size <= snapshot->tree_capacity &&
+		   snapshot_index(snapshot->cached_free_head,
+						  snapshot->cached_capacity) &&
+		   snapshot_index(snapshot->cached_root, snapshot->cached_capacity) &&
+		   snapshot_index(snapshot->cached_head, snapshot->cached_capacity) &&
+		   snapshot->cached_size <= snapshot->cached_capacity;
+}
+
+bool snapshot_check_tree(tree_t *tree, size_t heap_size)
+{
+	// The unused nodes are linked by their next node, and hold nothing else
+	size_t steps = 0;
+	for (size_t node = tree->free_head; node != NO_BLOCK;
+		 node = tree->nodes[node].next)
+		if (node >= tree->capacity || ++steps > tree->capacity)
+			return false;
+
+	if (tree->root == NO_BLOCK)
+		return tree->head == NO_BLOCK && !tree->size;
+
+	// Walk the tree with the range of addresses every node has to be in, so
+	// no node is reached twice and every search ends
+	size_t *stack = malloc(3 * (tree->size + 1) * sizeof(size_t));
+	bool *seen = calloc(tree->capacity, sizeof(bool));
+	DIE(!stack || !seen, "Malloc failed while checking a snapshot");
+
+	size_t depth = 0, visited = 0;
+	bool valid = true;
+	stack[depth++] = tree->root;
+	stack[depth++] = 0;
+	stack[depth++] = heap_size;
+	while (valid && depth) {
+		size_t high = stack[--depth];
+		size_t low = stack[--depth];
+		tree_node_t *node = &tree->nodes[stack[--depth]];
+
+		// Every block has to be inside its range, and the heap
+		valid = ++visited <= tree->size && node->address >= low &&
+				node->address <= high && node->size &&
+				node->size <= high - node->address &&
+				snapshot_index(node->left, tree->capacity) &&
+				snapshot_index(node->right, tree->capacity) &&
+				snapshot_index(node->next, tree->capacity) &&
+				snapshot_index(node->prev, tree->capacity);
+		if (!valid)
+			break;
+
+		seen[node - tree->nodes] = true;
+		if (node->left != NO_BLOCK) {
+			stack[depth++] = node->left;
+			stack[depth++] = low;
+			stack[depth++] = node->address;
+		}
+		if (node->right != NO_BLOCK) {
+			stack[depth++] = node->right;
+			stack[depth++] = node->address + node->size;
+			stack[depth++] = high;
+		}
+	}
+
+	// The blocks are also linked in address order, through the same nodes
+	size_t prev = NO_BLOCK;
+	steps = 0;
+	for (size_t node = tree->head; valid && node != NO_BLOCK;
+		 node = tree->nodes[node].next) {
+		valid = seen[node] && tree->nodes[node].prev == prev &&
+				++steps <= tree->size;
+		prev = node;
+	}
+
+	free(stack);
+	free(seen);
+	return valid && visited == tree->size && steps == tree->size;
+}
+
+bool snapshot_check_lists(sfl_heap_t *heap)
+{
+	sfl_t *sfl = &heap->sfl;
+	pool_t *pool = &sfl->pool;
+
+	// Every initial list keeps the shape sfl_init() gave it, its uncarved
+	// blocks being a whole number of blocks
+	for (size_t i = 0; i < sfl->regions_num; i++) {
+		region_t *region = &sfl->regions[i];
+		size_t element_size = 8 * ((size_t)1 << i);
+		size_t start = i * heap->bytes_per_list;
+		size_t blocks = element_size <= sfl->max_size ?
+							heap->bytes_per_list / element_size :
+							0;
+
+		if (region->end != start + blocks * element_size ||
+			region->next < start || region->next > region->touched ||
+			region->touched > region->end ||
+			(region->next - start) % element_size)
+			return false;
+	}
+
+	// The used records of the pool are the ones of its table
+	size_t used = 0;
+	for (size_t slot = 0; slot < pool->table_size; slot++) {
+		if (pool->table[slot] == NO_BLOCK)
+			continue;
+		if (pool->table[slot] >= pool->capacity)
+			return false;
+		used += 1;
+	}
+
+	size_t steps = 0;
+	for (size_t node = pool->free_head; node != NO_BLOCK;
+		 node = pool->blocks[node].next)
+		if (node >= pool->capacity || ++steps > pool->capacity)
+			return false;
+
+	if (used != pool->used)
+		return false;
+
+	// Every list holds its linked blocks along with its uncarved ones, and
+	// is marked in the bitmap if it is not empty
+	size_t lists_num = 0, records = 0;
+	for (size_t page = 0; page < sfl->list_pages; page++) {
+		for (size_t i = 0; sfl->lists[page] && i < LIST_PAGE_SIZE; i++) {
+			list_t *list = &sfl->lists[page][i];
+			size_t size = page * LIST_PAGE_SIZE + i;
+			if (!size || size > sfl->max_size) {
+				if (list->size || list->linked)
+					return false;
+				continue;
+			}
+
+			region_t *region = find_region(sfl, size);
+			size_t uncarved =
+				region ? (region->end - region->next) / size : 0;
+
+			if (list->linked > list->size ||
+				list->size - list->linked != uncarved ||
+				bitmap_test(&sfl->used, size) != (list->size != 0))
+				return false;
+			lists_num += list->size != 0;
+
+			// The large blocks link their headers inside the heap, which is
+			// only read once they are used, so only the head is checked
+			if (!list->linked)
+				continue;
+			if (size >= MIN_INTRUSIVE_SIZE) {
+				if (list->head > sfl->heap_size - size ||
+					ALIGN_UP(list->head) + sizeof(block_t) > sfl->heap_size)
+					return false;
+				continue;
+			}
+
+			// The small blocks are linked through the pool, in address order,
+			// and their records are found by their address
+			size_t prev = NO_BLOCK, node = list->head;
+			for (size_t j = 0; j < list->linked; j++) {
+				if (node >= pool->capacity)
+					return false;
+
+				block_t *block = &pool->blocks[node];
+				if (block->size != size || block->prev != prev ||
+					block->address > sfl->heap_size - size ||
+					(prev != NO_BLOCK &&
+					 block->address <= pool->blocks[prev].address) ||
+					pool_find(pool, block->address) != node)
+					return false;
+
+				prev = node;
+				node = block->next;
+			}
+
+			if (node != NO_BLOCK)
+				return false;
+			records += list->linked;
+		}
+	}
+
+	// Every used record of the pool belongs to a list
+	if (records != pool->used)
+		return false;
+
+	// The bitmap marks no other size
+	size_t marked = 0;
+	for (size_t size = bitmap_next(&sfl->used, 0); size < sfl->used.bits;
+		 size = bitmap_next(&sfl->used, size + 1))
+		marked += 1;
+
+	return marked == lists_num && lists_num == sfl->lists_num;
+}
+
+bool snapshot_check_magazines(sfl_heap_t *heap)
+{
+	if (!heap->magazines)
+		return !heap->magazine_blocks && !heap->cached_blocks.size;
+
+	// Every kept block is inside the heap and, if the heap unites its free
+	// blocks, in the index of the kept blocks
+	size_t blocks = 0;
+	for (size_t size = 0; size <= MAGAZINE_MAX_SIZE; size++) {
+		magazine_t *magazine = &heap->magazines[size];
+		if (magazine->count > MAGAZINE_DEPTH)
+			return false;
+
+		for (size_t i = 0; i < magazine->count; i++) {
+			size_t block_address = magazine->blocks[i];
+			if (size > heap->sfl.heap_size ||
+				block_address > heap->sfl.heap_size - size ||
+				(magazine_indexed(heap) &&
+				 tree_find(&heap->cached_blocks, block_address) == NO_BLOCK))
+				return false;
+		}
+
+		blocks += magazine->count;
+	}
+
+	return blocks == heap->magazine_blocks &&
+		   heap->cached_blocks.size ==
+			   (magazine_indexed(heap) ? blocks : 0);
+}
+
+int sfl_snapshot(sfl_heap_t *heap, const char *path)
+{
+	// Write a new file next to the old one, which only takes its place once
+	// it is complete, so a heap restored from the old one keeps its mapping
+	size_t length = strlen(path);
+	char *temporary = malloc(length + sizeof(SNAPSHOT_SUFFIX));
+	DIE(!temporary, "Malloc failed while allocating temporary");
+	memcpy(temporary, path, length);
+	memcpy(temporary + length, SNAPSHOT_SUFFIX, sizeof(SNAPSHOT_SUFFIX));
+
+	int fd = mkstemp(temporary);
+	if (fd == -1) {
+		free(temporary);
+		return 0;
+	}
+
+	// Give the file the permissions fopen() would have given it, mkstemp()
+	// only letting its owner read it
+	mode_t mask = umask(0);
+	umask(mask);
+	fchmod(fd, 0666 & ~mask);
+
+	// Only a lack of memory keeps a stream from being opened on the file
+	FILE *file = fdopen(fd, "wb");
+	DIE(!file, "Fdopen failed while opening the snapshot");
+
+	sfl_t *sfl = &heap->sfl;
+	pool_t *pool = &sfl->pool;
+	tree_t *tree = &heap->allocated_blocks;
+	tree_t *cached = &heap->cached_blocks;
+	pthread_mutex_lock(&heap->lock);
+
+	// Save everything but the arrays, which are all indexed by offsets or
+	// record numbers, so none of them holds a pointer
+	snapshot_t snapshot;
+	memset(&snapshot, 0, sizeof(snapshot));
+	memcpy(snapshot.magic, SNAPSHOT_MAGIC, sizeof(snapshot.magic));
+	snapshot.start_address = heap->start_address;
+	snapshot.lists_num = sfl->regions_num;
+	snapshot.bytes_per_list = heap->bytes_per_list;
+	snapshot.reconstruct_type = heap->reconstruct_type;
+	snapshot.policy = heap->policy;
+	snapshot.next_size = heap->next_size;
+	snapshot.malloc_calls = heap->malloc_calls;
+	snapshot.free_calls = heap->free_calls;
+	snapshot.fragmentations = heap->fragmentations;
+	snapshot.allocated_memory = heap->allocated_memory;
+	snapshot.used_lists = sfl->lists_num;
+	for (size_t i = 0; i < sfl->list_pages; i++)
+		snapshot.list_pages += sfl->lists[i] != NULL;
+	snapshot.free_memory = sfl->free_memory;
+	snapshot.free_blocks = sfl->free_blocks;
+	snapshot.wasted_memory = sfl->wasted_memory;
+	snapshot.resident_memory = sfl->resident_memory;
+	snapshot.released_memory = sfl->released_memory;
+	memcpy(snapshot.class_blocks, sfl->class_blocks,
+		   sizeof(snapshot.class_blocks));
+	memcpy(snapshot.class_memory, sfl->class_memory,
+		   sizeof(snapshot.class_memory));
+	snapshot.pool_capacity = pool->capacity;
+	snapshot.pool_free_head = pool->free_head;
+	snapshot.pool_table_size = pool->table_size;
+	snapshot.pool_used = pool->used;
+	snapshot.tree_capacity = tree->capacity;
+	snapshot.tree_free_head = tree->free_head;
+	snapshot.tree_root = tree->root;
+	snapshot.tree_head = tree->head;
+	snapshot.tree_size = tree->size;
+	snapshot.magazines = heap->magazines != NULL;
+	snapshot.magazine_blocks = heap->magazine_blocks;
+	snapshot.cached_capacity = cached->capacity;
+	snapshot.cached_free_head = cached->free_head;
+	snapshot.cached_root = cached->root;
+	snapshot.cached_head = cached->head;
+	snapshot.cached_size = cached->size;
+
+	// The heap data starts at the first page after the arrays, so it can be
+	// mapped on its own
+	size_t size = sizeof(snapshot_t) +
+				  snapshot.list_pages *
+					  (sizeof(size_t) + LIST_PAGE_SIZE * sizeof(list_t)) +
+				  sfl->regions_num * sizeof(region_t) +
+				  pool->capacity * sizeof(block_t) +
+				  pool->table_size * sizeof(size_t) +
+				  tree->capacity * sizeof(tree_node_t) +
+				  snapshot.magazines * (MAGAZINE_MAX_SIZE + 1) *
+					  sizeof(magazine_t) +
+				  cached->capacity * sizeof(tree_node_t);
+	for (size_t level = 0; level < sfl->used.levels; level++)
+		size += snapshot_words(&sfl->used, level) * sizeof(uint64_t);
+	// The two bitmaps of the states of the pages have the same shape
+	for (size_t level = 0; level < sfl->touched.levels; level++)
+		size += 2 * snapshot_words(&sfl->touched, level) * sizeof(uint64_t);
+	for (size_t order = 0; order < sfl->orders_num; order++)
+		for (size_t level = 0; level < sfl->buddies[order].levels; level++)
+			size += snapshot_words(&sfl->buddies[order], level) *
+					sizeof(uint64_t);
+	snapshot.data_offset = (size + HEAP_PAGE_SIZE - 1) &
+						   ~(size_t)(HEAP_PAGE_SIZE - 1);
+
+	// Write the pages of lists which were used, every one after its index,
+	// then the other arrays in a fixed order, then the heap data
+	bool written = snapshot_put(file, &snapshot, sizeof(snapshot));
+	for (size_t i = 0; written && i < sfl->list_pages; i++)
+		written = !sfl->lists[i] ||
+				  (snapshot_put(file, &i, sizeof(i)) &&
+				   snapshot_put(file, sfl->lists[i],
+								LIST_PAGE_SIZE * sizeof(list_t)));
+
+	written =
+		written && snapshot_put_bitmap(file, &sfl->used) &&
+		snapshot_put_bitmap(file, &sfl->touched) &&
+		snapshot_put_bitmap(file, &sfl->released) &&
+		snapshot_put(file, sfl->regions,
+					 sfl->regions_num * sizeof(region_t)) &&
+		snapshot_put(file, pool->blocks, pool->capacity * sizeof(block_t)) &&
+		snapshot_put(file, pool->table, pool->table_size * sizeof(size_t)) &&
+		snapshot_put(file, tree->nodes,
+					 tree->capacity * sizeof(tree_node_t));
+	for (size_t order = 0; written && order < sfl->orders_num; order++)
+		written = snapshot_put_bitmap(file, &sfl->buddies[order]);
+
+	written = written &&
+			  snapshot_put(file, heap->magazines,
+						   snapshot.magazines * (MAGAZINE_MAX_SIZE + 1) *
+							   sizeof(magazine_t)) &&
+			  snapshot_put(file, cached->nodes,
+						   cached->capacity * sizeof(tree_node_t));
+
+	written = written && !fseek(file, snapshot.data_offset, SEEK_SET) &&
+			  snapshot_put(file, sfl->heap_data, sfl->heap_size);
+
+	pthread_mutex_unlock(&heap->lock);
+
+	// The snapshot is only complete if it reached the disk, and the old file
+	// is only replaced then
+	bool complete = fclose(file) == 0 && written && !rename(temporary, path);
+	if (!complete)
+		remove(temporary);
+
+	free(temporary);
+	return complete;
+}
+
+sfl_heap_t *sfl_restore(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+
+	// Read the start of the snapshot and check that it is one, with arrays
+	// which fit in the file
+	snapshot_t snapshot;
+	struct stat status;
+	if (fread(&snapshot, sizeof(snapshot), 1, file) != 1 ||
+		fstat(fileno(file), &status) ||
+		!snapshot_valid(&snapshot, status.st_size)) {
+		fclose(file);
+		return NULL;
+	}
+
+	// Map the arrays, which are copied, since most of them grow
+	char *file_data = mmap(NULL, snapshot.data_offset, PROT_READ,
+						   MAP_PRIVATE, fileno(file), 0);
+	if (file_data == MAP_FAILED) {
+		fclose(file);
+		return NULL;
+	}
+
+	// Create a heap of the same shape, then fill it from the snapshot
+	sfl_heap_t *heap = sfl_init(snapshot.start_address, snapshot.lists_num,
+								snapshot.bytes_per_list,
+								snapshot.reconstruct_type);
+	sfl_t *sfl = &heap->sfl;
+	pool_t *pool = &sfl->pool;
+	tree_t *tree = &heap->allocated_blocks;
+	tree_t *cached = &heap->cached_blocks;
+
+	heap->policy = snapshot.policy < SFL_POLICIES ? snapshot.policy :
+													SFL_BEST_FIT;
+	heap->next_size = snapshot.next_size;
+	heap->malloc_calls = snapshot.malloc_calls;
+	heap->free_calls = snapshot.free_calls;
+	heap->fragmentations = snapshot.fragmentations;
+	heap->allocated_memory = snapshot.allocated_memory;
+	sfl->lists_num = snapshot.used_lists;
+	sfl->free_memory = snapshot.free_memory;
+	sfl->free_blocks = snapshot.free_blocks;
+	sfl->wasted_memory = snapshot.wasted_memory;
+	sfl->resident_memory = snapshot.resident_memory;
+	sfl->released_memory = snapshot.released_memory;
+	memcpy(sfl->class_blocks, snapshot.class_blocks,
+		   sizeof(sfl->class_blocks));
+	memcpy(sfl->class_memory, snapshot.class_memory,
+		   sizeof(sfl->class_memory));
+
+	// The pool and the tree get arrays of the saved capacity
+	if (snapshot.pool_capacity) {
+		pool->blocks = malloc(snapshot.pool_capacity * sizeof(block_t));
+		DIE(!pool->blocks, "Malloc failed while allocating pool->blocks");
+	}
+	if (snapshot.pool_table_size) {
+		pool->table = malloc(snapshot.pool_table_size * sizeof(size_t));
+		DIE(!pool->table, "Malloc failed while allocating pool->table");
+	}
+	pool->capacity = snapshot.pool_capacity;
+	pool->free_head = snapshot.pool_free_head;
+	pool->table_size = snapshot.pool_table_size;
+	pool->used = snapshot.pool_used;
+
+	if (snapshot.tree_capacity) {
+		tree->nodes = malloc(snapshot.tree_capacity * sizeof(tree_node_t));
+		DIE(!tree->nodes, "Malloc failed while allocating tree->nodes");
+	}
+	tree->capacity = snapshot.tree_capacity;
+	tree->free_head = snapshot.tree_free_head;
+	tree->root = snapshot.tree_root;
+	tree->head = snapshot.tree_head;
+	tree->size = snapshot.tree_size;
+
+	// So do the magazines and the index of the blocks they keep
+	heap->magazine_blocks = snapshot.magazine_blocks;
+	if (snapshot.magazines) {
+		heap->magazines = malloc((MAGAZINE_MAX_SIZE + 1) * sizeof(magazine_t));
+		DIE(!heap->magazines, "Malloc failed while allocating magazines");
+	}
+
+	if (snapshot.cached_capacity) {
+		cached->nodes = malloc(snapshot.cached_capacity * sizeof(tree_node_t));
+		DIE(!cached->nodes, "Malloc failed while allocating cached->nodes");
+	}
+	cached->capacity = snapshot.cached_capacity;
+	cached->free_head = snapshot.cached_free_head;
+	cached->root = snapshot.cached_root;
+	cached->head = snapshot.cached_head;
+	cached->size = snapshot.cached_size;
+
+	// Copy the arrays in the order they were written
+	size_t offset = sizeof(snapshot_t);
+	size_t limit = snapshot.data_offset;
+	bool restored = true;
+	for (size_t i = 0; restored && i < snapshot.list_pages; i++) {
+		size_t page;
+		restored = snapshot_take(&page, file_data, &offset, limit,
+								 sizeof(page)) &&
+				   page < sfl->list_pages &&
+				   snapshot_take(find_list(sfl, page * LIST_PAGE_SIZE),
+								 file_data, &offset, limit,
+								 LIST_PAGE_SIZE * sizeof(list_t));
+	}
+
+	restored =
+		restored &&
+		snapshot_take_bitmap(&sfl->used, file_data, &offset, limit) &&
+		snapshot_take_bitmap(&sfl->touched, file_data, &offset, limit) &&
+		snapshot_take_bitmap(&sfl->released, file_data, &offset, limit) &&
+		snapshot_take(sfl->regions, file_data, &offset, limit,
+					  sfl->regions_num * sizeof(region_t)) &&
+		snapshot_take(pool->blocks, file_data, &offset, limit,
+					  pool->capacity * sizeof(block_t)) &&
+		snapshot_take(pool->table, file_data, &offset, limit,
+					  pool->table_size * sizeof(size_t)) &&
+		snapshot_take(tree->nodes, file_data, &offset, limit,
+					  tree->capacity * sizeof(tree_node_t));
+	for (size_t order = 0; restored && order < sfl->orders_num; order++)
+		restored = snapshot_take_bitmap(&sfl->buddies[order], file_data,
+										&offset, limit);
+
+	restored = restored &&
+			   snapshot_take(heap->magazines, file_data, &offset, limit,
+							 (heap->magazines != NULL) *
+								 (MAGAZINE_MAX_SIZE + 1) *
+								 sizeof(magazine_t)) &&
+			   snapshot_take(cached->nodes, file_data, &offset, limit,
+							 cached->capacity * sizeof(tree_node_t));
+
+	// Check every index of the arrays before the heap follows any of them,
+	// so a damaged snapshot is refused instead of crashing a later command
+	restored = restored && snapshot_check_lists(heap) &&
+			   snapshot_check_tree(tree, sfl->heap_size) &&
+			   snapshot_check_tree(cached, sfl->heap_size) &&
+			   snapshot_check_magazines(heap);
+
+	munmap(file_data, snapshot.data_offset);
+
+	// Replace the empty heap data with a private mapping of the saved one,
+	// whose pages are only read from the file once they are used
+	if (restored) {
+		void *heap_data = mmap(sfl->heap_data, sfl->heap_size,
+							   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+							   fileno(file), snapshot.data_offset);
+		restored = heap_data != MAP_FAILED;
+	}
+
+	fclose(file);
+
+	if (!restored) {
+		sfl_destroy(heap);
+		return NULL;
+	}
+
+	return heap;
+}
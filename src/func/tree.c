@@ -0,0 +1,211 @@
+#include "../header.h"
+
+void tree_init(tree_t *tree)
+{
+	// Start with no nodes, they are allocated on the first insertion
+	tree->nodes = NULL;
+	tree->capacity = 0;
+	tree->free_head = NO_BLOCK;
+	tree->root = NO_BLOCK;
+	tree->head = NO_BLOCK;
+	tree->size = 0;
+}
+
+void tree_destroy(tree_t *tree)
+{
+	// Free all the nodes at once
+	free(tree->nodes);
+	tree_init(tree);
+}
+
+size_t tree_priority(size_t address)
+{
+	// Mix the bits of the address, so the priorities look random but the
+	// shape of the tree only depends on the addresses it holds
+	uint64_t x = address + 0x9e3779b97f4a7c15;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+
+	return x ^ (x >> 31);
+}
+
+size_t tree_floor(tree_t *tree, size_t address)
+{
+	// Remember the last node which was not after the address
+	size_t floor = NO_BLOCK;
+	PROFILE(size_t steps = 0;)
+
+	for (size_t current = tree->root; current != NO_BLOCK;) {
+		PROFILE(steps += 1;)
+
+		if (tree->nodes[current].address <= address) {
+			floor = current;
+			current = tree->nodes[current].right;
+		} else {
+			current = tree->nodes[current].left;
+		}
+	}
+
+	PROFILE(histogram_add(&tree->profile->walks[WALK_TREE], steps);)
+	return floor;
+}
+
+size_t tree_find(tree_t *tree, size_t address)
+{
+	// Find the last node which is not after the address
+	size_t node = tree_floor(tree, address);
+
+	// Check if it starts exactly at the address
+	if (node == NO_BLOCK || tree->nodes[node].address != address)
+		return NO_BLOCK;
+
+	return node;
+}
+
+size_t tree_insert_node(tree_t *tree, size_t root, size_t node)
+{
+	// The node becomes the root of an empty subtree
+	if (root == NO_BLOCK)
+		return node;
+
+	tree_node_t *nodes = tree->nodes;
+	size_t priority = tree_priority(nodes[node].address);
+
+	if (nodes[node].address < nodes[root].address) {
+		// Add the node to the left subtree
+		size_t left = tree_insert_node(tree, nodes[root].left, node);
+		nodes[root].left = left;
+
+		// Rotate to the right if the new child has a higher priority
+		if (left == node && priority > tree_priority(nodes[root].address)) {
+			nodes[root].left = nodes[left].right;
+			nodes[left].right = root;
+			return left;
+		}
+	} else {
+		// Add the node to the right subtree
+		size_t right = tree_insert_node(tree, nodes[root].right, node);
+		nodes[root].right = right;
+
+		// Rotate to the left if the new child has a higher priority
+		if (right == node && priority > tree_priority(nodes[root].address)) {
+			nodes[root].right = nodes[right].left;
+			nodes[right].left = root;
+			return right;
+		}
+	}
+
+	return root;
+}
+
+size_t tree_insert(tree_t *tree, size_t address, size_t size)
+{
+	// Grow the array of nodes if every node is used
+	if (tree->free_head == NO_BLOCK) {
+		size_t capacity = tree->capacity ? 2 * tree->capacity : POOL_SIZE;
+
+		tree->nodes = realloc(tree->nodes, capacity * sizeof(tree_node_t));
+		DIE(!tree->nodes, "Realloc failed while reallocating tree nodes");
+		PROFILE(tree->profile->growths[GROWTH_TREE] += 1;)
+
+		// Link the new nodes, so the lowest index is used first
+		for (size_t i = capacity; i > tree->capacity; i--) {
+			tree->nodes[i - 1].next = tree->free_head;
+			tree->free_head = i - 1;
+		}
+
+		tree->capacity = capacity;
+	}
+
+	// Take the first unused node
+	size_t node = tree->free_head;
+	tree_node_t *nodes = tree->nodes;
+	tree->free_head = nodes[node].next;
+
+	// Initialise the data of the node
+	nodes[node].address = address;
+	nodes[node].size = size;
+	nodes[node].left = NO_BLOCK;
+	nodes[node].right = NO_BLOCK;
+
+	// Link the node after the last one with a lower address
+	size_t prev = tree_floor(tree, address);
+	size_t next = prev == NO_BLOCK ? tree->head : nodes[prev].next;
+
+	nodes[node].prev = prev;
+	nodes[node].next = next;
+
+	if (prev != NO_BLOCK)
+		nodes[prev].next = node;
+	else
+		tree->head = node;
+
+	if (next != NO_BLOCK)
+		nodes[next].prev = node;
+
+	// Add the node to the tree and update the number of nodes
+	tree->root = tree_insert_node(tree, tree->root, node);
+	tree->size += 1;
+
+	return node;
+}
+
+size_t tree_merge(tree_t *tree, size_t left, size_t right)
+{
+	// Nothing to merge if one of the subtrees is empty
+	if (left == NO_BLOCK)
+		return right;
+	if (right == NO_BLOCK)
+		return left;
+
+	tree_node_t *nodes = tree->nodes;
+
+	// The root with the higher priority stays on top
+	if (tree_priority(nodes[left].address) >
+		tree_priority(nodes[right].address)) {
+		nodes[left].right = tree_merge(tree, nodes[left].right, right);
+		return left;
+	}
+
+	nodes[right].left = tree_merge(tree, left, nodes[right].left);
+	return right;
+}
+
+size_t tree_remove_node(tree_t *tree, size_t root, size_t address)
+{
+	tree_node_t *nodes = tree->nodes;
+
+	// Replace the node with the merge of its subtrees once it is found
+	if (address == nodes[root].address)
+		return tree_merge(tree, nodes[root].left, nodes[root].right);
+
+	// Remove the node from the subtree which holds it
+	if (address < nodes[root].address)
+		nodes[root].left = tree_remove_node(tree, nodes[root].left, address);
+	else
+		nodes[root].right = tree_remove_node(tree, nodes[root].right, address);
+
+	return root;
+}
+
+void tree_remove(tree_t *tree, size_t node)
+{
+	tree_node_t *nodes = tree->nodes;
+
+	// Remove the node from the tree
+	tree->root = tree_remove_node(tree, tree->root, nodes[node].address);
+
+	// Remove the node from the address order
+	if (nodes[node].prev != NO_BLOCK)
+		nodes[nodes[node].prev].next = nodes[node].next;
+	else
+		tree->head = nodes[node].next;
+
+	if (nodes[node].next != NO_BLOCK)
+		nodes[nodes[node].next].prev = nodes[node].prev;
+
+	// Update the number of nodes and give the node back
+	tree->size -= 1;
+	nodes[node].next = tree->free_head;
+	tree->free_head = node;
+}
@@ -7,149 +7,952 @@
 // Functions from src/func/heap.c
 
 // @brief Function to initialize the heap
-// @param heap_start The starting address of the heap
 // @param lists_num The number of segregated free lists
 // @param bytes_per_list The number of bytes per list
-// @param heap_data Pointer to store the allocated memory for the heap
-// @return The array of segregated free lists
-list_t *init_heap(size_t heap_start, size_t lists_num, size_t bytes_per_list,
-				  void **heap_data);
+// @return The segregated free lists, indexed by the block size, along with
+// the allocated memory for the heap
+sfl_t init_heap(size_t lists_num, size_t bytes_per_list);
 
 // @brief Function to free the memory of the heap
-// @param sfl_lists The array of segregated free lists
-// @param  lists_num The number of segregated free lists
-// @param heap_data Pointer to the allocated memory for the heap
-// @param allocated_blocks Linked list of allocated blocks
-void destroy_heap(list_t *sfl_lists, size_t lists_num, void *heap_data,
-				  list_t allocated_blocks);
+// @param sfl Pointer to the segregated free lists
+// @param allocated_blocks Pointer to the index of allocated blocks
+void destroy_heap(sfl_t *sfl, tree_t *allocated_blocks);
+
+// @brief Function to give the whole pages of a free block back to the system,
+// keeping the page with its header
+// @param sfl Pointer to the segregated free lists
+// @param block_address The offset of the free block
+// @param block_size The size of the free block
+void release_pages(sfl_t *sfl, size_t block_address, size_t block_size);
+
+// @brief Function to count the pages of the heap data a block was carved from
+// for the first time as resident
+// @param sfl Pointer to the segregated free lists
+// @param start The offset of the first byte carved
+// @param end The offset after the last byte carved
+void touch_pages(sfl_t *sfl, size_t start, size_t end);
+
+// @brief Function to count the released pages a block covers as resident
+// again, since they are used once the block is written
+// @param sfl Pointer to the segregated free lists
+// @param block_address The offset of the block
+// @param block_size The size of the block
+void use_pages(sfl_t *sfl, size_t block_address, size_t block_size);
+
+// @brief Function to ask the system for the bytes of the heap data kept in
+// memory, with a step for every page of the heap
+// @param sfl Pointer to the segregated free lists
+// @return The bytes of the resident pages of the heap data
+size_t resident_memory(sfl_t *sfl);
+
+// Functions from src/func/bitmap.c
+
+// @brief Function to allocate an empty hierarchical bitmap
+// @param bitmap Pointer to the bitmap to initialize
+// @param bits The number of bits of the bitmap
+void bitmap_init(bitmap_t *bitmap, size_t bits);
+
+// @brief Function to free the memory of a bitmap
+// @param bitmap Pointer to the bitmap to free
+void bitmap_destroy(bitmap_t *bitmap);
+
+// @brief Function to set a bit of a bitmap
+// @param bitmap Pointer to the bitmap
+// @param index The index of the bit
+void bitmap_set(bitmap_t *bitmap, size_t index);
+
+// @brief Function to clear a bit of a bitmap
+// @param bitmap Pointer to the bitmap
+// @param index The index of the bit
+void bitmap_clear(bitmap_t *bitmap, size_t index);
+
+// @brief Function to check if a bit of a bitmap is set
+// @param bitmap Pointer to the bitmap
+// @param index The index of the bit
+// @return True if the bit is set, false otherwise
+bool bitmap_test(bitmap_t *bitmap, size_t index);
+
+// @brief Function to find the first set bit at or after an index
+// @param bitmap Pointer to the bitmap
+// @param index The index to start the search from
+// @return The index of the set bit, or the number of bits if there is none
+size_t bitmap_next(bitmap_t *bitmap, size_t index);
+
+// @brief Function to find the last set bit
+// @param bitmap Pointer to the bitmap
+// @return The index of the set bit, or the number of bits if there is none
+size_t bitmap_last(bitmap_t *bitmap);
+
+// Functions from src/func/blocks.c
+
+// @brief Function to initialize an empty pool of block records
+// @param pool Pointer to the pool
+void pool_init(pool_t *pool);
+
+// @brief Function to free the memory of a pool
+// @param pool Pointer to the pool
+void pool_destroy(pool_t *pool);
+
+// @brief Function to take an unused record from a pool
+// @param pool Pointer to the pool
+// @return The index of the record
+size_t pool_alloc(pool_t *pool);
+
+// @brief Function to give a record back to a pool
+// @param pool Pointer to the pool
+// @param index The index of the record
+void pool_free(pool_t *pool, size_t index);
+
+// @brief Function to find the slot where the search for an address starts
+// @param pool Pointer to the pool
+// @param address The offset of a block
+// @return The slot of the table where the address is hashed
+size_t pool_hash(pool_t *pool, size_t address);
+
+// @brief Function to move the used records of a pool to a new table
+// @param pool Pointer to the pool
+// @param table_size The number of slots of the new table, a power of two
+void pool_rehash(pool_t *pool, size_t table_size);
+
+// @brief Function to add a used record to the table of a pool
+// @param pool Pointer to the pool
+// @param index The index of the record, whose address is already set
+void pool_insert(pool_t *pool, size_t index);
+
+// @brief Function to find the record of a block by its address
+// @param pool Pointer to the pool
+// @param address The offset of the block
+// @return The index of the record, NO_BLOCK if there is no such record
+size_t pool_find(pool_t *pool, size_t address);
+
+// @brief Function to remove a used record from the table of a pool
+// @param pool Pointer to the pool
+// @param index The index of the record
+void pool_erase(pool_t *pool, size_t index);
+
+// @brief Function to find the record of a free block
+// @param sfl Pointer to the segregated free lists
+// @param size The size of the block (the index of its list)
+// @param node The offset of the block if it is large, its pool index otherwise
+// @return Pointer to the record of the block
+block_t *free_block(sfl_t *sfl, size_t size, size_t node);
+
+// @brief Function to find the uncarved blocks of a given size
+// @param sfl Pointer to the segregated free lists
+// @param size The size of the blocks
+// @return Pointer to the uncarved part of the initial list with blocks of the
+// given size, NULL if there is no such list
+region_t *find_region(sfl_t *sfl, size_t size);
+
+// @brief Function to find the segregated free list of a given size, allocating
+// the page of the table which holds it if none of its sizes was used before
+// @param sfl Pointer to the segregated free lists
+// @param size The size of the blocks, at most the largest block size
+// @return Pointer to the list
+list_t *find_list(sfl_t *sfl, size_t size);
+
+// Functions from src/func/buddy.c
+
+// @brief Function to allocate the bitmaps of the buddy system of a heap
+// @param heap Pointer to the heap, whose lists are already initialized
+void buddy_init(sfl_heap_t *heap);
+
+// @brief Function to free the bitmaps of the buddy system, if there are any
+// @param sfl Pointer to the segregated free lists
+void buddy_destroy(sfl_t *sfl);
+
+// @brief Function to find the bit of a block in the bitmap of its order
+// @param heap Pointer to the heap
+// @param block_address The offset of the block
+// @param block_size The size of the block, a power of two
+// @return The index of the bit
+size_t buddy_index(sfl_heap_t *heap, size_t block_address, size_t block_size);
+
+// @brief Function to mark a block as free (or not) in the bitmap of its order,
+// unless it is a whole parent block, which has no buddy
+// @param heap Pointer to the heap
+// @param block_address The offset of the block
+// @param block_size The size of the block, a power of two
+// @param added true if the block became free, false if it was taken
+void buddy_mark(sfl_heap_t *heap, size_t block_address, size_t block_size,
+				bool added);
+
+// @brief Function to allocate a block with the buddy system, rounding its
+// size up to a power of two and splitting a larger block in halves
+// @param heap Pointer to the heap
+// @param block_size The size of the block to allocate
+// @return The offset of the allocated block, NO_BLOCK if nothing was allocated
+size_t buddy_malloc(sfl_heap_t *heap, size_t block_size);
+
+// @brief Function to allocate an aligned block with the buddy system, keeping
+// the aligned part while splitting a larger block in halves
+// @param heap Pointer to the heap
+// @param alignment The alignment of the address, a power of two
+// @param block_size The size of the block to allocate
+// @return The offset of the allocated block, NO_BLOCK if nothing was allocated
+size_t buddy_memalign(sfl_heap_t *heap, size_t alignment, size_t block_size);
+
+// @brief Function to change the size of an allocated block in place with the
+// buddy system, splitting it in halves if the rounded size is smaller
+// @param heap Pointer to the heap
+// @param node The node of the block in the index of allocated blocks
+// @param new_size The new size of the block, not 0
+// @return True if the block was resized, false if it has to move
+bool buddy_resize(sfl_heap_t *heap, size_t node, size_t new_size);
+
+// @brief Function to free a block with the buddy system, uniting it with its
+// buddy (found by a XOR of its offset) while the buddy is free
+// @param heap Pointer to the heap
+// @param block_address The offset of the block, no longer allocated
+// @param block_size The size of the block
+void buddy_free(sfl_heap_t *heap, size_t block_address, size_t block_size);
+
+// Functions from src/func/magazine.c
+
+// @brief Function to check if a heap indexes the blocks of its magazines
+// @param heap Pointer to the heap
+// @return True if the heap unites the freed blocks with all their free
+// neighbours, which must not be united across a kept block
+bool magazine_indexed(sfl_heap_t *heap);
+
+// @brief Function to keep a freed block in the magazine of its size, instead
+// of giving it back to the lists
+// @param heap Pointer to the heap
+// @param block_address The offset of the block, no longer allocated
+// @param block_size The size of the block
+// @return True if the block was kept, false if the heap has no magazines, the
+// size has none or its magazine is full
+bool magazine_push(sfl_heap_t *heap, size_t block_address, size_t block_size);
+
+// @brief Function to take the block freed last from the magazine of a size
+// @param heap Pointer to the heap
+// @param block_size The size of the block
+// @return The offset of the block, NO_BLOCK if the magazine is empty
+size_t magazine_pop(sfl_heap_t *heap, size_t block_size);
+
+// @brief Function to give the blocks of every magazine back to the lists
+// @param heap Pointer to the heap
+void magazine_flush(sfl_heap_t *heap);
+
+// @brief Function to find the first size whose magazine is not empty
+// @param heap Pointer to the heap
+// @param block_size The size the search starts from
+// @return The size, NO_BLOCK if there is none
+size_t magazine_next(sfl_heap_t *heap, size_t block_size);
+
+// @brief Function to find the largest size whose magazine is not empty
+// @param heap Pointer to the heap
+// @return The size, 0 if every magazine is empty
+size_t magazine_last(sfl_heap_t *heap);
+
+// @brief Function to get the blocks of a magazine in address order
+// @param heap Pointer to the heap
+// @param block_size The size of the blocks
+// @param blocks The array the offsets are put in, of MAGAZINE_DEPTH entries
+// @return The number of blocks
+size_t magazine_sorted(sfl_heap_t *heap, size_t block_size, size_t *blocks);
+
+// Functions from src/func/snapshot.c
+
+// @brief Function to write an array to a snapshot
+// @param file The snapshot
+// @param data The array
+// @param size The bytes of the array
+// @return true if the whole array was written, false otherwise
+bool snapshot_put(FILE *file, const void *data, size_t size);
+
+// @brief Function to copy an array from a mapped snapshot, moving past it
+// @param data The array to fill
+// @param file_data The mapped snapshot
+// @param offset Pointer to the offset of the array, moved to its end
+// @param limit The offset where the arrays of the snapshot end
+// @param size The bytes of the array
+// @return true if the array was inside the snapshot, false otherwise
+bool snapshot_take(void *data, const char *file_data, size_t *offset,
+				   size_t limit, size_t size);
+
+// @brief Function to find the number of words of a level of a bitmap
+// @param bitmap Pointer to the bitmap
+// @param level The level
+// @return The number of words
+size_t snapshot_words(bitmap_t *bitmap, size_t level);
+
+// @brief Function to write the words of every level of a bitmap to a snapshot
+// @param file The snapshot
+// @param bitmap Pointer to the bitmap
+// @return true if every word was written, false otherwise
+bool snapshot_put_bitmap(FILE *file, bitmap_t *bitmap);
+
+// @brief Function to copy the words of every level of a bitmap from a mapped
+// snapshot, into a bitmap of the same number of bits
+// @param bitmap Pointer to the bitmap
+// @param file_data The mapped snapshot
+// @param offset Pointer to the offset of the words, moved to their end
+// @param limit The offset where the arrays of the snapshot end
+// @return true if the words were inside the snapshot, false otherwise
+bool snapshot_take_bitmap(bitmap_t *bitmap, const char *file_data,
+						  size_t *offset, size_t limit);
+
+// @brief Function to check an index of a snapshot against its array
+// @param index The index, NO_BLOCK if it is missing
+// @param count The number of elements of the array
+// @return true if the index is missing or inside the array, false otherwise
+bool snapshot_index(size_t index, size_t count);
+
+// @brief Function to check the start of a snapshot, before any of its arrays
+// is allocated: the shape of the heap, the sizes of the arrays against the
+// part of the file before the heap data, and the indexes it holds
+// @param snapshot Pointer to the start of the snapshot
+// @param file_size The bytes of the file
+// @return true if the start is valid, false otherwise
+bool snapshot_valid(snapshot_t *snapshot, size_t file_size);
+
+// @brief Function to check the nodes of a restored index of blocks, walking
+// the tree with the range of addresses of every node, then the links in
+// address order
+// @param tree Pointer to the index
+// @param heap_size The bytes of the heap data
+// @return true if every reachable node is valid, false otherwise
+bool snapshot_check_tree(tree_t *tree, size_t heap_size);
+
+// @brief Function to check the restored regions, lists, bitmap and pool of a
+// heap against each other, without reading the heap data
+// @param heap The heap
+// @return true if they are consistent, false otherwise
+bool snapshot_check_lists(sfl_heap_t *heap);
+
+// @brief Function to check the restored magazines of a heap
+// @param heap The heap
+// @return true if every kept block is valid, false otherwise
+bool snapshot_check_magazines(sfl_heap_t *heap);
+
+// Functions from src/func/tree.c
+
+// @brief Function to initialize an empty index of allocated blocks
+// @param tree Pointer to the index
+void tree_init(tree_t *tree);
+
+// @brief Function to free the memory of an index
+// @param tree Pointer to the index
+void tree_destroy(tree_t *tree);
+
+// @brief Function to calculate the treap priority of a node
+// @param address The address of the node
+// @return The priority of the node
+size_t tree_priority(size_t address);
+
+// @brief Function to find the last block which starts at or before an address
+// @param tree Pointer to the index
+// @param address The address to search for
+// @return The node of the block, NO_BLOCK if there is none
+size_t tree_floor(tree_t *tree, size_t address);
+
+// @brief Function to find the block which starts at an address
+// @param tree Pointer to the index
+// @param address The address to search for
+// @return The node of the block, NO_BLOCK if there is none
+size_t tree_find(tree_t *tree, size_t address);
+
+// @brief Function to add a node to a subtree
+// @param tree Pointer to the index
+// @param root The root of the subtree
+// @param node The node to add
+// @return The new root of the subtree
+size_t tree_insert_node(tree_t *tree, size_t root, size_t node);
+
+// @brief Function to add a block to an index
+// @param tree Pointer to the index
+// @param address The address of the block
+// @param size The size of the block
+// @return The node of the block
+size_t tree_insert(tree_t *tree, size_t address, size_t size);
+
+// @brief Function to merge two subtrees, all the nodes of the left one being
+// before the ones of the right one
+// @param tree Pointer to the index
+// @param left The root of the left subtree
+// @param right The root of the right subtree
+// @return The root of the merged subtree
+size_t tree_merge(tree_t *tree, size_t left, size_t right);
+
+// @brief Function to remove the node with a given address from a subtree
+// @param tree Pointer to the index
+// @param root The root of the subtree
+// @param address The address of the node
+// @return The new root of the subtree
+size_t tree_remove_node(tree_t *tree, size_t root, size_t address);
+
+// @brief Function to remove a block from an index
+// @param tree Pointer to the index
+// @param node The node of the block
+void tree_remove(tree_t *tree, size_t node);
 
 // Functions from src/func/lists.c
 
-// @brief Function to add a node to the linked list of allocated blocks
-// @param sfl_lists Pointer to the array of segregated free lists
-// @param index The index of the segregated free list
+// @brief Function to add a node to the index of allocated blocks
+// @param sfl Pointer to the segregated free lists
+// @param index The index of the segregated free list (its block size)
 // @param block_size The size of the block to add
-// @param allocated_blocks Pointer to the linked list of allocated blocks
-// @param lists_num Pointer to the number of segregated free lists
-// @return The address of the block added
-size_t add_ll_node(list_t **sfl_lists, size_t index, size_t block_size,
-				   list_t *allocated_blocks, size_t *lists_num);
+// @param allocated_blocks Pointer to the index of allocated blocks
+// @return The offset of the block added
+size_t add_ll_node(sfl_t *sfl, size_t index, size_t block_size,
+				   tree_t *allocated_blocks);
+
+// @brief Function to carve the first uncarved block of an initial list
+// @param sfl Pointer to the segregated free lists
+// @param index The index of the segregated free list (its block size)
+// @return The offset of the block
+size_t carve_block(sfl_t *sfl, size_t index);
 
 // @brief Function to add a node to the segregated free list
-// @param block_address The address of the block to add
+// @param block_address The offset of the block to add
 // @param block_size The size of the block to add
-// @param sfl_lists Pointer to the array of segregated free lists
-// @param lists_num Pointer to the number of segregated free lists
-void add_sfl_node(size_t block_address, size_t block_size, list_t **sfl_lists,
-				  size_t *lists_num);
+// @param sfl Pointer to the segregated free lists
+void add_sfl_node(size_t block_address, size_t block_size, sfl_t *sfl);
+
+// @brief Function to remove a node from a segregated free list
+// @param sfl Pointer to the segregated free lists
+// @param index The index of the segregated free list (its block size)
+// @param node The node to remove
+void remove_sfl_node(sfl_t *sfl, size_t index, size_t node);
 
-// @brief Function to remove a node from the linked list of allocated blocks
-// @param allocated_blocks Pointer to the linked list of allocated blocks
+// @brief Function to remove a free block, found by its address, from its
+// segregated free list
+// @param sfl Pointer to the segregated free lists
+// @param block_address The offset of the block
+// @param block_size The size of the block
+void remove_free_block(sfl_t *sfl, size_t block_address, size_t block_size);
+
+// @brief Function to remove a node from the index of allocated blocks
+// @param allocated_blocks Pointer to the index of allocated blocks
 // @param block_address The address of the block to remove
-// @param heap_data Pointer to the allocated memory for the heap
 // @param start_address The starting address of the heap
-// @return A pointer to the node removed
-node_t *remove_ll_node(list_t *allocated_blocks, size_t block_address,
-					   void *heap_data, size_t start_address);
+// @return The size of the block removed, NO_BLOCK if it was not found
+size_t remove_ll_node(tree_t *allocated_blocks, size_t block_address,
+					  size_t start_address);
+
+// @brief Function to count blocks in (or out of) the free memory of a heap
+// @param sfl Pointer to the segregated free lists
+// @param block_size The size of the blocks
+// @param count The number of blocks
+// @param added true if the blocks became free, false if they were taken
+void count_free_blocks(sfl_t *sfl, size_t block_size, size_t count,
+					   bool added);
+
+// @brief Function to count a block in (or out of) the allocated memory of a
+// heap and of the initial list it was carved from
+// @param heap Pointer to the heap
+// @param block_address The offset of the block
+// @param block_size The size of the block
+// @param added true if the block was allocated, false if it was freed
+void count_allocated_block(sfl_heap_t *heap, size_t block_address,
+						   size_t block_size, bool added);
 
 // Functions from src/func/memory.c
 
+// @brief Function to find the segregated free list a malloc call takes its
+// block from, following the placement policy of the heap
+// @param heap Pointer to the heap
+// @param block_size The size of the block to allocate
+// @return The index of the list (its block size), larger than the largest
+// block size if no list has a block large enough
+size_t find_fit(sfl_heap_t *heap, size_t block_size);
+
+// @brief Function to find how many bytes of a block come before the first
+// aligned address inside it
+// @param heap Pointer to the heap
+// @param block_address The offset of the block
+// @param alignment The alignment, a power of two
+// @return The number of bytes before the aligned address
+size_t align_offset(sfl_heap_t *heap, size_t block_address, size_t alignment);
+
+// @brief Function to find the free block of a segregated free list with the
+// lowest address which holds an aligned range of a given size
+// @param heap Pointer to the heap
+// @param index The index of the segregated free list (its block size)
+// @param alignment The alignment of the range, a power of two
+// @param block_size The size of the range
+// @param step The number of bytes before the range must be a multiple of it
+// @return The offset of the free block, NO_BLOCK if none of them holds it
+size_t find_aligned(sfl_heap_t *heap, size_t index, size_t alignment,
+					size_t block_size, size_t step);
+
+// @brief Function to take a given free block out of its segregated free list
+// @param sfl Pointer to the segregated free lists
+// @param index The index of the segregated free list (its block size)
+// @param block_address The offset of the block, linked or the first uncarved
+// @return The offset of the block
+size_t take_free_block(sfl_t *sfl, size_t index, size_t block_address);
+
+// @brief Function to find a placement policy by its name
+// @param name The name of the policy, like best-fit
+// @return The policy, SFL_POLICIES if there is no such policy
+sfl_policy_t find_policy(const char *name);
+
+// @brief Function to get the name of a placement policy
+// @param policy The policy
+// @return The name of the policy
+const char *policy_name(sfl_policy_t policy);
+
 // @brief Function to allocate memory using segregated free lists
-// @param block_size The size of the memory to allocate
-// @param sfl_lists Pointer to the array of segregated free lists
-// @param  lists_num Pointer to the number of segregated free lists
-// @param allocated_blocks Pointer to the linked list of allocated blocks
-// @param fragmentations Pointer to the count of fragmentations
-// @param malloc_calls Pointer to the count of malloc calls
-void malloc_f(list_t **sfl_lists, size_t *lists_num, list_t *allocated_blocks,
-			  size_t *fragmentations, size_t *malloc_calls);
-
-// @brief Function to unite the block that needs to be freed to adjacent free
-// blocks
-// @param lists_num Pointer to the number of segregated free lists
-// @param sfl_lists Pointer to the array of segregated free lists
-// @param block_address Pointer to the address of the block to unite
+// @param heap Pointer to the heap
+// @param block_size The size of the block to allocate
+// @return The offset of the allocated block, NO_BLOCK if nothing was allocated
+size_t malloc_f(sfl_heap_t *heap, size_t block_size);
+
+// @brief Function to shrink a range around a block to the gap between the
+// blocks of an index right before and after it
+// @param tree Pointer to the index, which does not hold the block
+// @param block_address The offset of the block
+// @param left Pointer to the start of the range
+// @param right Pointer to the end of the range
+void find_gap(tree_t *tree, size_t block_address, size_t *left, size_t *right);
+
+// @brief Function to unite the block that needs to be freed to the free
+// blocks next to it from the same parent block
+// @param sfl Pointer to the segregated free lists
+// @param allocated_blocks Pointer to the index of allocated blocks, which no
+// longer holds the block
+// @param cached_blocks Pointer to the index of the blocks kept by the
+// magazines, which are free but not in the lists
+// @param block_address Pointer to the offset of the block to unite
 // @param block_size Pointer to the size of the block to unite
-// @param heap_data Pointer to the allocated memory for the heap
-// @param start_address The starting address of the heap
-// @return True if it united blocks, false otherwise
-bool defragment(size_t *lists_num, list_t **sfl_lists, size_t *block_address,
-				size_t *block_size, void *heap_data, size_t start_address);
+// @param bytes_per_list The number of bytes per list
+void coalesce(sfl_t *sfl, tree_t *allocated_blocks, tree_t *cached_blocks,
+			  size_t *block_address, size_t *block_size, size_t bytes_per_list);
 
 // @brief Function to free memory using segregated free lists
-// @param sfl_lists Pointer to the array of segregated free lists
-// @param  lists_num Pointer to the number of segregated free lists
-// @param allocated_blocks Pointer to the linked list of allocated blocks
-// @param free_calls Pointer to the count of free calls
-// @param reconstruct_type The type of reconstruction to be done
-// @param heap_data Pointer to the allocated memory for the heap
-// @param start_address The starting address of the heap
-void free_f(list_t **sfl_lists, size_t *lists_num, list_t *allocated_blocks,
-			size_t *free_calls, size_t reconstruct_type, void *heap_data,
-			size_t start_address, size_t bytes_per_list);
+// @param heap Pointer to the heap
+// @param block_address The address of the block to free
+// @return True if the block was freed (or the address is 0), false if it was
+// not found
+bool free_f(sfl_heap_t *heap, size_t block_address);
+
+// @brief Function to give a block which is no longer allocated back to the
+// segregated free lists, uniting it with its neighbours as the heap does
+// @param heap Pointer to the heap
+// @param block_address The offset of the block
+// @param block_size The size of the block
+void reclaim_block(sfl_heap_t *heap, size_t block_address, size_t block_size);
+
+// @brief Function to allocate a block of the exact size from its magazine
+// @param heap Pointer to the heap
+// @param block_size The size of the block to allocate
+// @return The offset of the allocated block, NO_BLOCK if the magazine of the
+// size is empty (or the heap has no magazines)
+size_t magazine_malloc(sfl_heap_t *heap, size_t block_size);
+
+// @brief Function to allocate a block whose address is a multiple of an
+// alignment, splitting the bytes before and after it off the free block
+// @param heap Pointer to the heap
+// @param alignment The alignment of the address, a power of two
+// @param block_size The size of the block to allocate
+// @return The offset of the allocated block, NO_BLOCK if nothing was allocated
+size_t memalign_f(sfl_heap_t *heap, size_t alignment, size_t block_size);
+
+// @brief Function to allocate a block filled with zeros
+// @param heap Pointer to the heap
+// @param block_size The size of the block to allocate
+// @return The offset of the allocated block, NO_BLOCK if nothing was allocated
+size_t calloc_f(sfl_heap_t *heap, size_t block_size);
+
+// @brief Function to change the size of an allocated block without moving
+// it, splitting its end off or taking the free block right after it
+// @param heap Pointer to the heap
+// @param node The node of the block in the index of allocated blocks
+// @param new_size The new size of the block, not 0
+// @return True if the block was resized, false if it has to move
+bool resize_block(sfl_heap_t *heap, size_t node, size_t new_size);
+
+// @brief Function to change the size of an allocated block, moving its bytes
+// to a new block if it cannot be resized in place
+// @param heap Pointer to the heap
+// @param block_address The address of the block, 0 to allocate a new one
+// @param block_size The new size of the block, 0 to free it
+// @param new_address Pointer to the offset of the block afterwards, NO_BLOCK
+// if there was not enough memory (the block being kept) or it was freed
+// @return True if the block was found (or the address is 0), false otherwise
+bool realloc_f(sfl_heap_t *heap, size_t block_address, size_t block_size,
+			   size_t *new_address);
+
+// @brief Function to check if a range of the heap is allocated
+// @param allocated_blocks Pointer to the index of allocated blocks
+// @param block_address The offset of the first byte, which can be inside a
+// block
+// @param size The number of bytes of the range
+// @return True if every byte of the range belongs to an allocated block, the
+// blocks being contiguous, false otherwise
+bool find_span(tree_t *allocated_blocks, size_t block_address, size_t size);
+
+// The functions from src/func/api.c are declared in src/sfl.h
+
+// Functions from src/func/cache.c, besides the sfl_cache_*() ones declared in
+// src/sfl.h
+
+// @brief Function to find the slot where the search for an address starts
+// @param cache Pointer to the cache
+// @param address The address of a block
+// @return The slot of the table where the address is hashed
+size_t cache_hash(sfl_cache_t *cache, size_t address);
+
+// @brief Function to move the blocks of a cache to a table of another size
+// @param cache Pointer to the cache
+// @param table_size The number of slots of the new table, a power of two
+void cache_rehash(sfl_cache_t *cache, size_t table_size);
+
+// @brief Function to remember a block given by a cache
+// @param cache Pointer to the cache
+// @param address The address of the block
+// @param size_class The size class of the block
+void cache_insert(sfl_cache_t *cache, size_t address, size_t size_class);
+
+// @brief Function to forget a block given by a cache
+// @param cache Pointer to the cache
+// @param address The address of the block
+// @return The size class of the block, CACHE_CLASSES if the cache did not give
+// the block
+size_t cache_erase(sfl_cache_t *cache, size_t address);
+
+// @brief Function to allocate half of a magazine from the heap
+// @param cache Pointer to the cache
+// @param size_class The size class of the magazine
+// @return The number of blocks of the magazine, 0 if the heap is out of memory
+size_t cache_refill(sfl_cache_t *cache, size_t size_class);
+
+// @brief Function to give the oldest blocks of a magazine back to the heap
+// @param cache Pointer to the cache
+// @param size_class The size class of the magazine
+// @param count The number of blocks
+void cache_drain(sfl_cache_t *cache, size_t size_class, size_t count);
+
+// Functions from src/func/preload.c, besides malloc() and the functions
+// around it, which it replaces when it is preloaded
+
+// @brief Function to map memory on its own, with its header right before it
+// @param size The number of bytes of the memory
+// @param alignment The alignment of the memory, a power of two of at least
+// PRELOAD_ALIGNMENT
+// @return The memory, NULL if it could not be mapped
+void *map_memory(size_t size, size_t alignment);
+
+// @brief Function to find the header of a memory mapped on its own
+// @param pointer The memory
+// @return Pointer to the header of the memory
+mapping_t *find_mapping(void *pointer);
+
+// @brief Function to allocate the metadata of the preloaded build
+// @param size The number of bytes
+// @return The memory, NULL if it could not be mapped
+void *meta_malloc(size_t size);
+
+// @brief Function to allocate zeroed metadata for the preloaded build
+// @param count The number of elements
+// @param size The size of an element
+// @return The memory, NULL if it could not be mapped
+void *meta_calloc(size_t count, size_t size);
+
+// @brief Function to resize the metadata of the preloaded build
+// @param pointer The memory, NULL to allocate a new one
+// @param size The new number of bytes
+// @return The memory, with the bytes that fit copied, NULL if it could not be
+// mapped
+void *meta_realloc(void *pointer, size_t size);
+
+// @brief Function to free the metadata of the preloaded build
+// @param pointer The memory, NULL to do nothing
+void meta_free(void *pointer);
+
+// @brief Function to read the parameters of the arenas from the environment
+// (SFL_LISTS_NUM, SFL_BYTES_PER_LIST, SFL_RECONSTRUCT_TYPE and SFL_POLICY)
+// @param arenas Pointer to the arenas
+void arenas_setup(arenas_t *arenas);
+
+// @brief Function to take the lock of the arenas and of every heap before a
+// fork, registered with pthread_atfork()
+void arenas_lock(void);
+
+// @brief Function to give back the locks taken by arenas_lock() after a fork,
+// in the parent and in the child
+void arenas_unlock(void);
+
+// @brief Function to create a new arena, whose addresses are the real ones
+// @param arenas Pointer to the arenas
+// @return The arena, which becomes the current one
+sfl_heap_t *arena_create(arenas_t *arenas);
+
+// @brief Function to find the arena a block belongs to
+// @param arenas Pointer to the arenas
+// @param address The address of the block
+// @return The arena, NULL if the block was mapped on its own
+sfl_heap_t *arena_find(arenas_t *arenas, size_t address);
+
+// @brief Function to allocate a block from an arena, aligned if the alignment
+// is stricter than PRELOAD_ALIGNMENT
+// @param heap Pointer to the arena
+// @param alignment The alignment of the block, a power of two
+// @param size The size of the block
+// @return The offset of the block, NO_BLOCK if there is not enough memory
+size_t arena_block(sfl_heap_t *heap, size_t alignment, size_t size);
+
+// @brief Function to allocate a block from the arenas, trying the current one
+// first, then the others, then a new one
+// @param arenas Pointer to the arenas
+// @param alignment The alignment of the block, a power of two
+// @param size The size of the block, a multiple of PRELOAD_ALIGNMENT no larger
+// than the largest block of an arena
+// @return The block, NULL if there is not enough memory
+void *arena_malloc(arenas_t *arenas, size_t alignment, size_t size);
+
+// @brief Function to find the number of bytes a block can hold
+// @param arenas Pointer to the arenas
+// @param pointer The block
+// @return The number of bytes
+size_t usable_size(arenas_t *arenas, void *pointer);
+
+// Functions from src/func/input.c
+
+// @brief Function to initialize the input from a file
+// @param input Pointer to the input
+// @param file The file the commands are read from
+void input_init(input_t *input, FILE *file);
+
+// @brief Function to free the memory of the input
+// @param input Pointer to the input
+void input_destroy(input_t *input);
+
+// @brief Function to read the next block of the file, after the bytes kept
+// from the mark, which are moved to the start of the buffer (growing it if
+// they fill it)
+// @param input Pointer to the input, whose buffer is used up unless it has a
+// mark
+// @return True if any byte was read, false at the end of the input
+bool input_refill(input_t *input);
+
+// @brief Function to keep the bytes from the current position in the buffer,
+// even when it is refilled
+// @param input Pointer to the input
+void input_mark(input_t *input);
+
+// @brief Function to stop keeping the bytes from the mark in the buffer
+// @param input Pointer to the input
+// @return The first byte kept, which stays in place until the buffer is
+// refilled again
+const char *input_release(input_t *input);
+
+// @brief Function to get the next character of the input, without consuming it
+// @param input Pointer to the input
+// @return The next character, EOF at the end of the input
+int input_peek(input_t *input);
+
+// @brief Function to skip the whitespace of the input
+// @param input Pointer to the input
+void input_skip(input_t *input);
+
+// @brief Function to read a word from the input
+// @param input Pointer to the input
+// @param word The memory where the word is stored
+// @param size The size of the memory, longer words are truncated
+// @return The length of the word, 0 at the end of the input
+size_t input_word(input_t *input, char *word, size_t size);
+
+// @brief Function to read a command from the input
+// @param input Pointer to the input
+// @return The command matching the keyword that was read
+command_t input_command(input_t *input);
+
+// @brief Function to read a hexadecimal number, with or without 0x
+// @param input Pointer to the input
+// @return The number read
+size_t input_hex(input_t *input);
+
+// @brief Function to read a decimal number
+// @param input Pointer to the input
+// @return The number read
+size_t input_decimal(input_t *input);
+
+// @brief Function to skip a text placed in between quotation marks, keeping
+// it in the buffer of the input, with a mark on its first byte
+// @param input Pointer to the input
+// @return The number of bytes of the text
+size_t input_text(input_t *input);
+
+// @brief Function to find the keyword of a command
+// @param command The command
+// @return The keyword, "UNKNOWN" for the words which are not commands
+const char *command_name(command_t command);
+
+// @brief Function to read the arguments of a command, in the format of the
+// input
+// @param input Pointer to the input
+// @param command The command whose arguments are read
+// @param arguments Pointer to the arguments, whose text points into the
+// buffer of the input and stays valid only until the next command is read
+void input_arguments(input_t *input, command_t command, arguments_t *arguments);
+
+// Functions from src/func/binary.c
+
+// @brief Function to read a variable-length number, 7 bits per byte
+// @param input Pointer to the input
+// @return The number read, SIZE_MAX if it does not fit in 64 bits
+size_t binary_varint(input_t *input);
+
+// @brief Function to check and skip the first bytes of a binary trace, called
+// at the start of the input, which is left untouched if they do not match
+// @param input Pointer to the input
+// @return True if the input starts like a binary trace, false otherwise
+bool binary_magic(input_t *input);
+
+// @brief Function to read the opcode of a command from a binary trace
+// @param input Pointer to the input
+// @return The command of the opcode
+command_t binary_command(input_t *input);
+
+// @brief Function to skip a text of a binary trace, prefixed by its length,
+// keeping it in the buffer of the input, with a mark on its first byte
+// @param input Pointer to the input
+// @return The number of bytes of the text
+size_t binary_text(input_t *input);
+
+// @brief Function to read the arguments of a command from a binary trace
+// @param input Pointer to the input
+// @param command The command whose arguments are read
+// @param arguments Pointer to the arguments, whose text points into the
+// buffer of the input and stays valid only until the next command is read
+void binary_arguments(input_t *input, command_t command,
+					  arguments_t *arguments);
+
+// @brief Function to write a variable-length number, 7 bits per byte
+// @param output The file to write to
+// @param number The number to write
+void binary_put_varint(FILE *output, size_t number);
+
+// @brief Function to write a text, prefixed by its length
+// @param output The file to write to
+// @param text The text to write
+// @param length The number of bytes of the text
+void binary_put_text(FILE *output, const char *text, size_t length);
+
+// @brief Function to write a command along with its arguments to a binary
+// trace
+// @param output The file to write to
+// @param command The command to write
+// @param arguments Pointer to the arguments of the command
+void binary_put_command(FILE *output, command_t command,
+						arguments_t *arguments);
+
+// @brief Function to convert text commands to a binary trace
+// @param input Pointer to the input, holding text commands
+// @param output The file the binary trace is written to
+void binary_convert(input_t *input, FILE *output);
+
+// Functions from src/func/output.c
+
+// @brief Function to write the bytes of the output to the standard output
+// @param output Pointer to the output
+void output_flush(output_t *output);
+
+// @brief Function to add a text to the output, flushing it if it is full
+// @param output Pointer to the output
+// @param text The text
+// @param length The number of bytes of the text
+void output_text(output_t *output, const char *text, size_t length);
+
+// @brief Function to add a null-terminated text to the output
+// @param output Pointer to the output
+// @param text The text
+void output_string(output_t *output, const char *text);
+
+// @brief Function to add a number to the output in hex, like printf("0x%lx")
+// @param output Pointer to the output
+// @param value The number
+void output_hex(output_t *output, size_t value);
+
+// @brief Function to add a number to the output in decimal, like
+// printf("%lu")
+// @param output Pointer to the output
+// @param value The number
+void output_decimal(output_t *output, size_t value);
 
 // Functions from src/func/read-write.c
 
 // @brief Function to read from a block of memory and manage segmentation faults
-// @param allocated_blocks The linked list of allocated blocks
-// @param heap_data Pointer to the allocated memory for the heap
-// @param start_address The starting address of the heap
-// @param command The command to be executed
-// @param free_calls The number of free calls
-// @param fragmentations The number of fragmentations
-// @param malloc_calls The number of malloc calls
-// @param sfl_lists The array of segregated free lists
-// @param lists_num The number of segregated free lists
+// @param heap Pointer to the heap
+// @param block_address The address to read from
+// @param read_size The number of bytes to read
 // @return True if the command was executed successfully, false otherwise
-bool read(list_t allocated_blocks, void *heap_data, size_t start_address,
-		  char *command, size_t free_calls, size_t fragmentations,
-		  size_t malloc_calls, list_t *sfl_lists, size_t lists_num);
+bool read(sfl_heap_t *heap, size_t block_address, size_t read_size);
 
 // @brief Function to write to a block of memory and manage segmentation faults
-// @param allocated_blocks The linked list of allocated blocks
-// @param heap_data Pointer to the allocated memory for the heap
-// @param start_address The starting address of the heap
-// @param command The command to be executed
-// @param free_calls The number of free calls
-// @param fragmentations The number of fragmentations
-// @param malloc_calls The number of malloc calls
-// @param sfl_lists The array of segregated free lists
-// @param lists_num The number of segregated free lists
+// @param heap Pointer to the heap
+// @param block_address The address to write to
+// @param text The text to write, up to its first null byte
+// @param text_length The number of bytes of the text
+// @param write_size The number of bytes to write, at most the text length
 // @return True if the command was executed successfully, false otherwise
-bool write(list_t allocated_blocks, void *heap_data, size_t start_address,
-		   char *command, size_t free_calls, size_t fragmentations,
-		   size_t malloc_calls, list_t *sfl_lists, size_t lists_num);
+bool write(sfl_heap_t *heap, size_t block_address, const char *text,
+		   size_t text_length, size_t write_size);
 
 // @brief Function to dump the memory statistics
-// @param  lists_num The number of segregated free lists
-// @param malloc_calls The number of malloc calls
-// @param fragmentations The number of fragmentations
-// @param free_calls The number of free calls
-// @param sfl_lists The array of segregated free lists
-// @param allocated_blocks The linked list of allocated blocks
-// @param start_address The starting address of the heap
-// @param heap_data Pointer to the allocated memory for the heap
-void dump_memory(size_t lists_num, size_t malloc_calls, size_t fragmentations,
-				 size_t free_calls, list_t *sfl_lists, list_t allocated_blocks,
-				 size_t start_address, void *heap_data);
+// @param heap Pointer to the heap
+void dump_memory(sfl_heap_t *heap);
+
+// @brief Function to print the totals of the heap, without the addresses
+// @param heap Pointer to the heap
+void print_stats(sfl_heap_t *heap);
+
+// @brief Function to print how the free memory of the heap is spread: the
+// largest free block, the external fragmentation index, the free blocks and
+// bytes of every size class and the occupancy of every initial list
+// @param heap Pointer to the heap
+void print_frag_report(sfl_heap_t *heap);
+
+// @brief Function to print a histogram of the profile, if it has any value
+// @param name The name of the histogram
+// @param histogram Pointer to the histogram
+void print_histogram(const char *name, histogram_t *histogram);
+
+// @brief Function to print the profile of the heap, or that the program was
+// built without it
+// @param heap Pointer to the heap
+void print_profile(sfl_heap_t *heap);
 
 // Functions from src/func/utils.c
 
-// @brief Function to find if two blocks come from the same parent block
-// @param first_address The address of the first block
-// @param second_address The address of the second block
-// @param heap_data Pointer to the allocated memory for the heap
+// @brief Function to add a value to a histogram of the profile
+// @param histogram Pointer to the histogram
+// @param value The value
+void histogram_add(histogram_t *histogram, size_t value);
+
+// @brief Function to find the parent block of a block
+// @param block_address The offset of the block
 // @param bytes_per_list The number of bytes per list
-// @return True if the two blocks come from the same parent block, false
-// otherwise
-bool same_parent(size_t first_address, size_t second_address, void *heap_data,
-				 size_t bytes_per_list);
+// @param start Pointer to the offset where the parent block starts
+// @param end Pointer to the offset where the parent block ends
+void find_parent(size_t block_address, size_t bytes_per_list, size_t *start,
+				 size_t *end);
+
+// Functions from src/func/cli.c
+
+// @brief Function to execute a command with its parsed arguments
+// @param heap Pointer to the heap, which is created by INIT_HEAP
+// @param command The command to execute
+// @param arguments Pointer to the arguments of the command
+// @return True if the program continues, false if it has to stop
+bool execute_command(sfl_heap_t **heap, command_t command,
+					 arguments_t *arguments);
 
-// @brief Function to read a block of memory placed in between quotation marks
-// @return The block of memory read
-char *read_text(void);
+// @brief Function to read the arguments of a command and execute it
+// @param heap Pointer to the heap, which is created by INIT_HEAP
+// @param input Pointer to the input
+// @param command The command to execute
+// @return True if the program continues, false if it has to stop
+bool run_command(sfl_heap_t **heap, input_t *input, command_t command);
 
 // @brief Function to run the program
-void run(void);
+// @param file The file the commands are read from
+// @param binary True if the commands are in the binary format
+// @param policy The placement policy of the heap
+// @param magazines True if the heap keeps freed blocks in magazines
+void run(FILE *file, bool binary, sfl_policy_t policy, bool magazines);
 
 #endif /* HEADER_H_ */
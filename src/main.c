@@ -1,9 +1,53 @@
 #include "header.h"
 
-int main(void)
+int main(int argc, char *argv[])
 {
-	// Run the program
-	run();
+	// Check the options, which come before the input file
+	bool binary = false, convert = false, magazines = false;
+	sfl_policy_t policy = SFL_BEST_FIT;
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-' && argv[i][1] == '-'; i++) {
+		if (!strcmp(argv[i], "--binary")) {
+			binary = true;
+		} else if (!strcmp(argv[i], "--convert")) {
+			convert = true;
+		} else if (!strcmp(argv[i], "--magazines")) {
+			magazines = true;
+		} else if (!strcmp(argv[i], "--policy") && i + 1 < argc &&
+				   find_policy(argv[i + 1]) != SFL_POLICIES) {
+			policy = find_policy(argv[++i]);
+		} else {
+			fprintf(stderr,
+					"Usage: %s [--binary | --convert] [--policy <policy>] "
+					"[--magazines] [file]\n"
+					"Policies: best-fit, first-fit, exact-fit-first, "
+					"next-fit\n",
+					argv[0]);
+			return 1;
+		}
+	}
+
+	// Read the commands from the given file, or from stdin otherwise
+	FILE *file = stdin;
+	if (i < argc) {
+		file = fopen(argv[i], binary ? "rb" : "r");
+		DIE(!file, "Fopen failed while opening the input file");
+	}
+
+	if (convert) {
+		// Convert the text commands to a binary trace on stdout
+		input_t input;
+		input_init(&input, file);
+		binary_convert(&input, stdout);
+		input_destroy(&input);
+	} else {
+		// Run the program
+		run(file, binary, policy, magazines);
+	}
+
+	// Close the input file
+	if (file != stdin)
+		fclose(file);
 
 	return 0;
 }
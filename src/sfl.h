@@ -0,0 +1,202 @@
+#ifndef SFL_H_
+#define SFL_H_
+
+#include <stddef.h>
+
+// A heap managed by segregated free lists, whose fields are private
+typedef struct sfl_heap_t sfl_heap_t;
+
+// The cache of one thread over a heap, whose fields are private
+typedef struct sfl_cache_t sfl_cache_t;
+
+// The number of size classes of the free blocks, of 2 ^ i to 2 ^ (i + 1) - 1
+// bytes
+#define SFL_CLASSES 64
+
+// The placement policies, which choose the free block a malloc call takes
+typedef enum {
+	SFL_BEST_FIT, // The smallest block that fits (the default)
+	SFL_FIRST_FIT, // The block with the lowest address that fits
+	SFL_EXACT_FIT_FIRST, // A block of the same size, else the largest one
+	SFL_NEXT_FIT, // The smallest block that fits, starting from the size of
+				  // the block taken by the previous call
+	SFL_POLICIES // The number of policies
+} sfl_policy_t;
+
+// Structure for the statistics of a heap
+typedef struct sfl_stats_t {
+	size_t total_memory; // The allocated memory plus the free memory
+	size_t allocated_memory; // The bytes of the allocated blocks
+	size_t free_memory; // The bytes of the free blocks
+	size_t free_blocks; // The number of free blocks
+	size_t allocated_blocks; // The number of allocated blocks
+	size_t malloc_calls; // The number of successful malloc calls
+	size_t free_calls; // The number of successful free calls
+	size_t fragmentations; // The number of blocks split by malloc calls
+	size_t largest_free_block; // The size of the largest free block
+	size_t wasted_memory; // The bytes of the free blocks smaller than the
+						  // blocks of the first list
+	sfl_policy_t policy; // The placement policy of the heap
+	size_t resident_memory; // The bytes of the pages blocks were carved from,
+							// without the released ones
+	size_t released_memory; // The bytes of the pages given back to the system
+							// by frees and not used since
+	size_t class_blocks[SFL_CLASSES]; // The free blocks of every size class
+	size_t class_memory[SFL_CLASSES]; // The free bytes of every size class
+} sfl_stats_t;
+
+// Structure for the occupancy of an initial list, whose blocks are the parent
+// blocks of every block carved from it
+typedef struct sfl_region_t {
+	size_t parent_size; // The size of the blocks of the initial list
+	size_t size; // The bytes of the whole blocks of the initial list
+	size_t allocated_memory; // The bytes of the list which are allocated
+	size_t allocated_blocks; // The allocated blocks carved from the list
+} sfl_region_t;
+
+// @brief Function to create a heap
+// @param start_address The address of the first byte of the heap, not 0
+// @param lists_num The number of initial lists, of 8, 16, 32... bytes blocks
+// @param bytes_per_list The number of bytes of every initial list
+// @param reconstruct_type 1 to unite the freed blocks with their free
+// neighbours from the same parent block, 2 for a buddy system, 0 otherwise
+// @return The heap
+sfl_heap_t *sfl_init(size_t start_address, size_t lists_num,
+					 size_t bytes_per_list, size_t reconstruct_type);
+
+// @brief Function to choose how a heap places the blocks it allocates
+// @param heap The heap
+// @param policy The placement policy, SFL_BEST_FIT for a new heap
+void sfl_set_policy(sfl_heap_t *heap, sfl_policy_t policy);
+
+// @brief Function to choose if a heap keeps a few freed blocks of every small
+// size, which the next allocations of the same size take first
+// @param heap The heap
+// @param enabled Non-zero to keep them, 0 to give them back to the free lists
+// (the default for a new heap)
+void sfl_set_magazines(sfl_heap_t *heap, int enabled);
+
+// @brief Function to free all the memory of a heap
+// @param heap The heap
+void sfl_destroy(sfl_heap_t *heap);
+
+// @brief Function to allocate a block from a heap
+// @param heap The heap
+// @param size The size of the block
+// @return The address of the block, 0 if there is not enough memory
+size_t sfl_malloc(sfl_heap_t *heap, size_t size);
+
+// @brief Function to allocate a block whose address is a multiple of an
+// alignment from a heap
+// @param heap The heap
+// @param alignment The alignment, a power of two
+// @param size The size of the block
+// @return The address of the block, 0 if there is not enough memory or the
+// alignment is not a power of two
+size_t sfl_memalign(sfl_heap_t *heap, size_t alignment, size_t size);
+
+// @brief Function to allocate a block filled with zeros from a heap
+// @param heap The heap
+// @param size The size of the block
+// @return The address of the block, 0 if there is not enough memory
+size_t sfl_calloc(sfl_heap_t *heap, size_t size);
+
+// @brief Function to change the size of a block of a heap, in place if it
+// shrinks or if the free memory after it is enough, by moving its bytes to a
+// new block otherwise
+// @param heap The heap
+// @param address The address of the block, 0 to allocate a new one
+// @param size The new size of the block, 0 to free it
+// @return The address of the block, 0 if there is no block allocated at the
+// address, if there is not enough memory (the block being kept) or if it
+// was freed
+size_t sfl_realloc(sfl_heap_t *heap, size_t address, size_t size);
+
+// @brief Function to free a block of a heap
+// @param heap The heap
+// @param address The address of the block, 0 to do nothing
+// @return 1 if the block was freed (or the address is 0), 0 if there is no
+// block allocated at the address
+int sfl_free(sfl_heap_t *heap, size_t address);
+
+// @brief Function to copy bytes from the allocated blocks of a heap
+// @param heap The heap
+// @param address The address of the first byte, which can be inside a block
+// @param buffer The memory the bytes are copied to
+// @param size The number of bytes
+// @return 1 if the bytes were copied, 0 if some of them are not allocated
+int sfl_read(sfl_heap_t *heap, size_t address, void *buffer, size_t size);
+
+// @brief Function to copy bytes to the allocated blocks of a heap
+// @param heap The heap
+// @param address The address of the first byte, which can be inside a block
+// @param data The bytes to copy
+// @param size The number of bytes
+// @return 1 if the bytes were copied, 0 if some of them are not allocated
+int sfl_write(sfl_heap_t *heap, size_t address, const void *data, size_t size);
+
+// @brief Function to get the statistics of a heap, which are kept up to date
+// by every call, so getting them does not depend on the size of the heap
+// @param heap The heap
+// @param stats Pointer to the statistics to fill
+void sfl_stats(sfl_heap_t *heap, sfl_stats_t *stats);
+
+// @brief Function to ask the system for the bytes of the heap data it keeps in
+// memory, which takes a step for every page of the heap, unlike the resident
+// memory of the statistics, counted by the heap itself
+// @param heap The heap
+// @return The bytes of the resident pages of the heap data
+size_t sfl_resident(sfl_heap_t *heap);
+
+// @brief Function to get the occupancy of every initial list of a heap, which
+// is kept up to date like the statistics
+// @param heap The heap
+// @param regions The array to fill, NULL to only count the initial lists
+// @param count The number of elements of the array
+// @return The number of initial lists of the heap
+size_t sfl_regions(sfl_heap_t *heap, sfl_region_t *regions, size_t count);
+
+// @brief Function to save a heap to a file, with its data, its lists, its
+// allocated blocks and its statistics, none of them holding a pointer
+// @param heap The heap
+// @param path The file, which is replaced
+// @return 1 if the whole snapshot was written, 0 otherwise
+int sfl_snapshot(sfl_heap_t *heap, const char *path);
+
+// @brief Function to create a heap from a snapshot, mapping its data from the
+// file, so only the pages which are used are ever read
+// @param path The file written by sfl_snapshot()
+// @return The heap, NULL if the file is not a valid snapshot
+sfl_heap_t *sfl_restore(const char *path);
+
+// The functions above can be called from many threads at once, since every one
+// of them locks the heap. A thread can also keep a cache of blocks, which only
+// locks the heap when it moves a batch of blocks from or to it.
+
+// @brief Function to create the cache of a thread
+// @param heap The heap the blocks come from
+// @return The cache, which must only be used by one thread
+sfl_cache_t *sfl_cache_create(sfl_heap_t *heap);
+
+// @brief Function to give the cached blocks back to the heap and free the
+// cache, the blocks still in use remaining allocated
+// @param cache The cache
+void sfl_cache_destroy(sfl_cache_t *cache);
+
+// @brief Function to allocate a block through a cache, the sizes of the cached
+// classes being rounded up to a multiple of 8
+// @param cache The cache
+// @param size The size of the block
+// @return The address of the block, 0 if there is not enough memory
+size_t sfl_cache_malloc(sfl_cache_t *cache, size_t size);
+
+// @brief Function to free a block through a cache, which keeps it if it was
+// allocated by the cache and frees it in the heap otherwise, so a block must
+// be freed through the cache it was allocated from
+// @param cache The cache
+// @param address The address of the block, 0 to do nothing
+// @return 1 if the block was freed (or the address is 0), 0 if there is no
+// block allocated at the address
+int sfl_cache_free(sfl_cache_t *cache, size_t address);
+
+#endif /* SFL_H_ */
@@ -5,32 +5,418 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "sfl.h"
+
+// The preloaded build replaces malloc() and the functions around it, so the
+// allocator cannot use them for its own memory, which is mapped directly
+#ifdef SFL_PRELOAD
+#define malloc(size) meta_malloc(size)
+#define calloc(count, size) meta_calloc(count, size)
+#define realloc(pointer, size) meta_realloc(pointer, size)
+#define free(pointer) meta_free(pointer)
+#endif
+
+// The profiled build (make PROFILE=1) keeps the statements of the
+// instrumentation, which disappear from the other builds
+#ifdef SFL_PROFILE
+#define PROFILE(...) __VA_ARGS__
+#else
+#define PROFILE(...)
+#endif
 
 // The size of the command from the input
 #define COMMAND_SIZE 100
 
-// The size of the text from the input
-#define TEXT_SIZE 600
+// The size of the blocks read from the input, the buffer growing for longer
+// texts
+#define INPUT_SIZE 65536
+
+// Marker for an input which keeps none of its bytes when it is refilled
+#define NO_MARK SIZE_MAX
+
+// The size of the file names of SNAPSHOT and RESTORE
+#define PATH_SIZE 4096
+
+// The size of the buffer the output is formatted in before it is written
+#define OUTPUT_SIZE 65536
+
+// The most characters a formatted number takes (0x and 16 hex digits, or 20
+// decimal digits)
+#define NUMBER_SIZE 24
+
+// The maximum number of levels of a bitmap (64 ^ 6 bits)
+#define BITMAP_LEVELS 6
+
+// The number of size classes kept by a cache, of 8, 16, 24... bytes
+#define CACHE_CLASSES 64
+
+// The number of free blocks a cache keeps for every size class
+#define MAGAZINE_SIZE 32
+
+// The largest block size a heap keeps freed blocks of, in its own magazines
+#define MAGAZINE_MAX_SIZE 512
+
+// The number of freed blocks a heap keeps for every size
+#define MAGAZINE_DEPTH 8
 
 // Boolean type for the C language
 typedef enum { false, true } bool;
 
-// Structure for a block in the heap
+// The commands which can be read from the input, their values being the
+// opcodes of the binary format
+typedef enum {
+	COMMAND_INIT_HEAP,
+	COMMAND_MALLOC,
+	COMMAND_FREE,
+	COMMAND_READ,
+	COMMAND_WRITE,
+	COMMAND_DUMP_MEMORY,
+	COMMAND_DESTROY_HEAP,
+	COMMAND_STATS,
+	COMMAND_SNAPSHOT,
+	COMMAND_RESTORE,
+	COMMAND_PROFILE,
+	COMMAND_FRAG_REPORT,
+	COMMAND_REALLOC,
+	COMMAND_CALLOC,
+	COMMAND_MEMALIGN,
+	COMMAND_UNKNOWN,
+	COMMAND_EOF
+} command_t;
+
+// Structure for an entry of the command table, matching a keyword
+typedef struct command_entry_t {
+	const char *name; // The keyword of the command
+	command_t type; // The command
+} command_entry_t;
+
+// The first bytes of a binary trace
+#define BINARY_MAGIC "SFLB"
+
+// Structure for the input, which is read from a file in large blocks
+typedef struct input_t {
+	FILE *file; // The file the commands are read from
+	char *buffer; // The last block read from the file
+	size_t capacity; // The number of bytes the buffer can hold
+	size_t size; // The number of bytes in the buffer
+	size_t pos; // The position of the next byte in the buffer
+	size_t mark; // The position of the first byte kept in the buffer when it
+				 // is refilled, NO_MARK if none is
+	bool regular; // True if the file is a regular one, read in whole blocks
+	bool binary; // True if the commands are in the binary format
+	sfl_policy_t policy; // The placement policy of the heaps created by
+						 // INIT_HEAP, which is not part of the commands
+	bool magazines; // True if the heaps keep the freed blocks in magazines
+} input_t;
+
+// Structure for the output, formatted in a large buffer which is written to
+// the standard output once it is full
+typedef struct output_t {
+	char buffer[OUTPUT_SIZE]; // The bytes formatted since the last flush
+	size_t size; // The number of bytes in the buffer
+} output_t;
+
+// Structure for the arguments of a command, parsed from the input
+typedef struct arguments_t {
+	size_t address; // The address of the block, or the start of the heap
+	size_t size; // The size to allocate, read or write
+	size_t alignment; // The alignment of MEMALIGN
+	size_t lists_num; // The number of segregated free lists
+	size_t bytes_per_list; // The number of bytes per list
+	size_t reconstruct_type; // The type of reconstruction
+	sfl_policy_t policy; // The placement policy, given by the input
+	bool magazines; // True if the heap has magazines, given by the input
+	const char *text; // The text to write, kept in the buffer of the input
+					  // until the next command is read
+	size_t text_length; // The number of bytes of the text
+	char path[PATH_SIZE]; // The file of SNAPSHOT and RESTORE
+} arguments_t;
+
+// The number of lists in a page of the table of lists, a page being allocated
+// once one of its sizes is used
+#define LIST_PAGE_SIZE 256
+
+// Marker for a missing block, used to end the lists
+#define NO_BLOCK SIZE_MAX
+
+// The smallest free block which keeps its metadata inside the heap
+#define MIN_INTRUSIVE_SIZE 64
+
+// The size of a page of the heap, the unit its free memory is released in
+#define HEAP_PAGE_SIZE 4096
+
+// The reconstruct_type of the buddy system, the other non-zero values uniting
+// the freed blocks with every free neighbour from the same parent block
+#define RECONSTRUCT_BUDDY 2
+
+// The free blocks smaller than this (the blocks of the first list) are
+// counted as wasted memory, since few requests can use them
+#define WASTED_SIZE 8
+
+// The number of records a pool or a tree starts with
+#define POOL_SIZE 64
+
+// The first offset, aligned to a word, at or after the given one
+#define ALIGN_UP(offset) (((offset) + 7) & ~(size_t)7)
+
+// The number of buckets of a histogram, bucket i counting the values of
+// 2 ^ (i - 1) to 2 ^ i - 1 and bucket 0 counting the zeros
+#define PROFILE_BUCKETS 48
+
+// Structure for a histogram of the profile, on a logarithmic scale
+typedef struct histogram_t {
+	size_t buckets[PROFILE_BUCKETS]; // The number of values of every bucket
+	size_t count; // The number of values
+	size_t total; // The sum of the values
+	size_t max; // The largest value
+} histogram_t;
+
+// The walks counted by the profile, by the structure they go through
+typedef enum {
+	WALK_TREE, // The nodes of the allocated blocks visited by a search
+	WALK_POOL, // The slots of the pool table probed by a search
+	WALK_SPAN, // The allocated blocks crossed by a READ or a WRITE
+	WALK_FIT, // The lists compared by a placement policy
+	WALKS // The number of walks
+} walk_t;
+
+// The arrays which grow by reallocation
+typedef enum {
+	GROWTH_POOL, // The records of the pool
+	GROWTH_TABLE, // The table of the pool
+	GROWTH_TREE, // The nodes of the allocated blocks
+	GROWTHS // The number of arrays
+} growth_t;
+
+// Structure for the profile of a heap, only filled by the profiled build
+typedef struct profile_t {
+	histogram_t latencies[COMMAND_EOF]; // The nanoseconds of every command
+	histogram_t walks[WALKS]; // The steps of every walk
+	histogram_t merges; // The blocks every FREE united the freed one with
+	size_t growths[GROWTHS]; // The reallocations of every array
+} profile_t;
+
+// Structure for a free block in the heap, which is either written inside the
+// heap (at least MIN_INTRUSIVE_SIZE bytes) or kept in a pool
 typedef struct block_t {
-	void *address; // The address of the block
+	size_t address; // The offset of the block from the start of the heap
 	size_t size; // The size of the block
+	size_t next, prev; // The next and previous blocks of its list
 } block_t;
 
-// Structure for a node in the segregated free list
-typedef struct node_t {
-	void *data; // The data of the node
-	struct node_t *next, *prev; // The next and previous nodes
-} node_t;
-
-// Structure for a segregated free list
+// Structure for a list of blocks, linked by the offsets of the large free
+// blocks or by the indexes of the pool records, which is empty when all of
+// its fields are 0
 typedef struct list_t {
-	node_t *head; // The head of the list
-	size_t size; // The size of the list
+	size_t head; // The head of the list, only set if some blocks are linked
+	size_t size; // The size of the list, along with its uncarved blocks
+	size_t linked; // The number of blocks linked in the list
 } list_t;
 
+// Structure for a pool of block records, which recycles the freed ones
+typedef struct pool_t {
+	block_t *blocks; // The records of the pool
+	size_t capacity; // The number of records
+	size_t free_head; // The first unused record
+	size_t *table; // The used records, hashed by the address of their block
+	size_t table_size; // The number of slots of the table
+	size_t used; // The number of used records
+#ifdef SFL_PROFILE
+	profile_t *profile; // The profile of the heap of the pool
+#endif
+} pool_t;
+
+// Structure for an allocated block, which is a node of the address index
+typedef struct tree_node_t {
+	size_t address; // The offset of the block from the start of the heap
+	size_t size; // The size of the block
+	size_t left, right; // The children of the node in the tree
+	size_t next, prev; // The next and previous blocks in address order
+} tree_node_t;
+
+// Structure for the index of the allocated blocks, a treap ordered by the
+// address of the blocks, whose nodes are also linked in address order
+typedef struct tree_t {
+	tree_node_t *nodes; // The nodes of the tree
+	size_t capacity; // The number of nodes
+	size_t free_head; // The first unused node
+	size_t root; // The root of the tree
+	size_t head; // The block with the lowest address
+	size_t size; // The number of blocks
+#ifdef SFL_PROFILE
+	profile_t *profile; // The profile of the heap of the tree
+#endif
+} tree_t;
+
+// Structure for the uncarved part of an initial list, whose blocks are handed
+// out in order and only get a record once they are freed
+typedef struct region_t {
+	size_t next; // The offset of the first uncarved block
+	size_t end; // The offset where the uncarved blocks end
+	size_t allocated_memory; // The bytes of the list which are allocated
+	size_t allocated_blocks; // The allocated blocks carved from the list
+	size_t touched; // The offset where the blocks ever carved end
+} region_t;
+
+// Structure for the freed blocks a heap keeps for one size, the last one
+// freed being the first one allocated
+typedef struct magazine_t {
+	size_t blocks[MAGAZINE_DEPTH]; // The offsets of the blocks
+	size_t count; // The number of blocks
+} magazine_t;
+
+// Structure for a hierarchical bitmap, every level marks the non-empty words
+// of the level below it
+typedef struct bitmap_t {
+	uint64_t *words[BITMAP_LEVELS]; // The words of every level
+	size_t counts[BITMAP_LEVELS]; // The number of bits of every level
+	size_t levels; // The number of levels
+	size_t bits; // The number of bits of the bottom level
+} bitmap_t;
+
+// The first bytes of a snapshot of a heap
+#define SNAPSHOT_MAGIC "SFLSNAP5"
+
+// The end of the name of the file a snapshot is written to, before it
+// replaces the old one, the Xs becoming a unique suffix
+#define SNAPSHOT_SUFFIX ".XXXXXX"
+
+// Structure for the start of a snapshot, with every field of a heap which is
+// not an array; the arrays follow it in a fixed order (the lists, the bitmaps,
+// the regions, the pool, the allocated blocks, the buddies, the magazines and
+// the blocks they keep), and the heap data starts at the first page after
+// them, so it can be mapped on its own
+typedef struct snapshot_t {
+	char magic[8]; // SNAPSHOT_MAGIC, without the null terminator
+	size_t start_address; // The parameters of INIT_HEAP
+	size_t lists_num, bytes_per_list, reconstruct_type;
+	size_t policy, next_size; // The placement policy and its state
+	size_t malloc_calls, free_calls, fragmentations; // The counters
+	size_t allocated_memory;
+	size_t used_lists; // The number of non-empty lists
+	size_t list_pages; // The number of pages of lists which were used
+	size_t free_memory, free_blocks, wasted_memory;
+	size_t resident_memory, released_memory;
+	size_t class_blocks[SFL_CLASSES], class_memory[SFL_CLASSES];
+	size_t pool_capacity, pool_free_head, pool_table_size, pool_used;
+	size_t tree_capacity, tree_free_head, tree_root, tree_head, tree_size;
+	size_t magazines; // 1 if the heap keeps freed blocks in magazines
+	size_t magazine_blocks; // The number of blocks they keep
+	size_t cached_capacity, cached_free_head, cached_root, cached_head;
+	size_t cached_size;
+	size_t data_offset; // The offset of the heap data in the file
+} snapshot_t;
+
+// Structure for the segregated free lists, indexed by the block size
+typedef struct sfl_t {
+	list_t **lists; // The pages of the free lists, one list for every
+					// possible block size, NULL for the unused pages
+	size_t list_pages; // The number of pages of the table of lists
+	size_t max_size; // The largest block size that can be stored
+	bitmap_t used; // The block sizes which have a non-empty list
+	size_t lists_num; // The number of non-empty lists
+	void *heap_data; // The memory of the heap, mapped on its own
+	size_t heap_size; // The bytes of the heap data
+	bitmap_t touched; // The pages of the heap data blocks were ever carved from
+	bitmap_t released; // The pages given back to the system by frees and
+					   // not used since
+	size_t resident_memory; // The bytes of the pages which are touched and
+							// not released
+	size_t released_memory; // The bytes of the pages which are released
+	pool_t pool; // The records of the free blocks too small to hold them
+	region_t *regions; // The uncarved blocks of every initial list
+	size_t regions_num; // The number of initial lists
+	size_t free_memory; // The bytes of the free blocks
+	size_t free_blocks; // The number of free blocks
+	size_t wasted_memory; // The bytes of the free blocks under WASTED_SIZE
+	size_t class_blocks[SFL_CLASSES]; // The free blocks of every size class
+	size_t class_memory[SFL_CLASSES]; // The free bytes of every size class
+	bitmap_t *buddies; // The free blocks of every order, for the buddy system
+	size_t orders_num; // The number of orders with a bitmap
+} sfl_t;
+
+// Structure for a heap, with everything the allocator needs
+struct sfl_heap_t {
+	sfl_t sfl; // The segregated free lists, along with the heap data
+	tree_t allocated_blocks; // The index of the allocated blocks
+	magazine_t *magazines; // The freed blocks kept for every size up to
+						   // MAGAZINE_MAX_SIZE, NULL if the heap keeps none
+	size_t magazine_blocks; // The number of blocks kept by the magazines
+	tree_t cached_blocks; // The index of the blocks kept by the magazines,
+						  // only for the heaps which unite free blocks
+	size_t malloc_calls; // The number of successful malloc calls
+	size_t free_calls; // The number of successful free calls
+	size_t fragmentations; // The number of fragmentations
+	size_t allocated_memory; // The bytes of the allocated blocks
+	size_t start_address; // The starting address of the heap
+	size_t bytes_per_list; // The number of bytes per list
+	size_t reconstruct_type; // The type of reconstruction
+	sfl_policy_t policy; // The placement policy
+	size_t next_size; // The size the next search starts from, for next-fit
+#ifdef SFL_PROFILE
+	profile_t profile; // The latencies, walks, merges and reallocations
+#endif
+	pthread_mutex_t lock; // The lock of everything above, for the threads
+};
+
+// Structure for a block given by a cache, along with its size class
+typedef struct cache_entry_t {
+	size_t address; // The address of the block, 0 for an empty slot
+	size_t size_class; // The magazine the block goes to when it is freed
+} cache_entry_t;
+
+// Structure for the cache of a thread, which keeps the freed blocks of every
+// size class to itself and moves them from and to the heap in batches
+struct sfl_cache_t {
+	sfl_heap_t *heap; // The heap the blocks come from
+	size_t magazines[CACHE_CLASSES][MAGAZINE_SIZE]; // The free blocks
+	size_t counts[CACHE_CLASSES]; // The number of blocks of every magazine
+	cache_entry_t *table; // The blocks given by the cache, by their address
+	size_t table_size; // The number of slots of the table
+	size_t used; // The number of blocks in the table
+};
+
+// The default number of lists of an arena of the preloaded build, so the
+// blocks of up to 8 * 2 ^ 14 bytes come from the arenas
+#define PRELOAD_LISTS_NUM 15
+
+// The default number of bytes of every list of an arena
+#define PRELOAD_BYTES_PER_LIST 1048576
+
+// The alignment of the blocks given by the preloaded malloc()
+#define PRELOAD_ALIGNMENT 16
+
+// The size of a page, for valloc() and pvalloc()
+#define PRELOAD_PAGE_SIZE 4096
+
+// The functions the preloaded build replaces, the only ones it exports, so
+// the program cannot replace the functions of the allocator by accident
+#define PRELOAD_EXPORT __attribute__((visibility("default")))
+
+// Structure for the header of a memory mapped on its own, placed right before
+// the memory given to the caller
+typedef struct mapping_t {
+	void *base; // The start of the mapping
+	size_t length; // The length of the mapping
+} mapping_t;
+
+// Structure for the arenas of the preloaded build, every one of them being a
+// heap whose data is mapped on its own
+typedef struct arenas_t {
+	sfl_heap_t **heaps; // The arenas, in the order they were created
+	size_t count; // The number of arenas
+	size_t capacity; // The number of arenas that fit in the array
+	size_t current; // The arena the last block was allocated from
+	size_t lists_num; // The number of lists of every arena
+	size_t bytes_per_list; // The number of bytes per list
+	size_t reconstruct_type; // The type of reconstruction
+	sfl_policy_t policy; // The placement policy of every arena
+	bool magazines; // True if every arena keeps freed blocks in magazines
+	bool ready; // True once the parameters were read from the environment
+	pthread_mutex_t lock; // The lock of every arena, for the threads
+} arenas_t;
+
 #endif /* STRUCTURES_H_ */